@@ -0,0 +1,436 @@
+#pragma once
+
+/** The binary format of \c Logger, and its decoder.
+ *
+ * In binary mode the logger doesn't format anything. The first time a call site is written to
+ * an output it is given an id, and its level and format string are written once; after that,
+ * each of its records is the id, the time and the arguments, packed with a one byte type tag
+ * each. \c BinaryLogDecoder reads them back into the same lines as the text mode, formatting the
+ * arguments with the same \c print_detail::format_arg as \c Printf, and can run anywhere later.
+ *
+ * An output starts with \c BINARY_LOG_MAGIC, followed by entries:
+ *   site:   0x01, id, level (1 byte), length, format
+ *   record: 0x02, id, time, argument count, arguments
+ * Ids, lengths, counts and integer arguments are LEB128 varints, signed ones zigzag encoded.
+ * The time is in nanoseconds since the epoch, as the difference to the previous record's.
+ * Floats and doubles are stored as their 4 and 8 bytes, strings as a length and the characters.
+ */
+
+#include "print.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace ccutils {
+
+enum class LogLevel : int { Debug, Info, Warning, Error };
+
+/// The constant part of a log statement, one per LOG_* call site.
+struct LogSite {
+    const char* format;
+    LogLevel level;
+};
+
+static constexpr char BINARY_LOG_MAGIC[8] = { 'C', 'C', 'L', 'O', 'G', '\0', '\1', '\0' };
+
+namespace detail {
+
+    enum class LogEntry : uint8_t { Site = 1, Record = 2 };
+
+    /// The type of an argument in a binary record, and its index in \c LogValue.
+    enum class LogTag : uint8_t {
+        Char,
+        SignedChar,
+        UnsignedChar,
+        Short,
+        UnsignedShort,
+        Int,
+        UnsignedInt,
+        Long,
+        UnsignedLong,
+        LongLong,
+        UnsignedLongLong,
+        Float,
+        Double,
+        LongDouble,
+        Pointer,
+        String,
+        NullString,
+    };
+
+    using LogValue = std::variant<char, signed char, unsigned char, short, unsigned short, int,
+        unsigned int, long, unsigned long, long long, unsigned long long, float, double, const void*,
+        const char*>;
+
+    inline void putVarint(std::string& out, uint64_t v) {
+        while (v >= 0x80) {
+            out += char(v | 0x80);
+            v >>= 7;
+        }
+        out += char(v);
+    }
+
+    inline uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+    inline int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+    template <class T> constexpr LogTag integerTag() {
+        if constexpr (std::is_same_v<T, char>)
+            return LogTag::Char;
+        else if constexpr (std::is_same_v<T, signed char>)
+            return LogTag::SignedChar;
+        else if constexpr (std::is_same_v<T, unsigned char>)
+            return LogTag::UnsignedChar;
+        else if constexpr (sizeof(T) == sizeof(short))
+            return std::is_signed_v<T> ? LogTag::Short : LogTag::UnsignedShort;
+        else if constexpr (sizeof(T) == sizeof(int))
+            return std::is_signed_v<T> ? LogTag::Int : LogTag::UnsignedInt;
+        else if constexpr (std::is_same_v<T, long> || std::is_same_v<T, unsigned long>)
+            return std::is_signed_v<T> ? LogTag::Long : LogTag::UnsignedLong;
+        else
+            return std::is_signed_v<T> ? LogTag::LongLong : LogTag::UnsignedLongLong;
+    }
+
+    inline void putLogString(std::string& out, std::string_view s) {
+        out += char(LogTag::String);
+        putVarint(out, s.size());
+        out.append(s.data(), s.size());
+    }
+
+    /** Appends an argument, as it is read back from a ring by \c LogArg, with its tag. Objects
+     *  are only printed with %$ or %?, so they are stored as the text their \c format_to writes
+     *  for `spec`, the conversion they go to.
+     **/
+    template <class T>
+    void putLogArg(std::string& out, const T& v, const print_detail::format_spec& spec = {}) {
+        if constexpr (std::is_enum_v<T>) {
+            putLogArg(out, static_cast<std::underlying_type_t<T>>(v));
+        } else if constexpr (std::is_integral_v<T>) {
+            out += char(integerTag<T>());
+            if constexpr (std::is_signed_v<T>)
+                putVarint(out, zigzag(int64_t(v)));
+            else
+                putVarint(out, uint64_t(v));
+        } else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+            out += char(std::is_same_v<T, float> ? LogTag::Float : LogTag::Double);
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &v, sizeof(T));
+            out.append(bytes, sizeof(T));
+        } else if constexpr (std::is_same_v<T, long double>) {
+            // formatted as a double anyway
+            const double d = double(v);
+            out += char(LogTag::LongDouble);
+            char bytes[sizeof(double)];
+            std::memcpy(bytes, &d, sizeof(double));
+            out.append(bytes, sizeof(double));
+        } else if constexpr (std::is_same_v<T, const char*>) {
+            if (v)
+                putLogString(out, v);
+            else
+                out += char(LogTag::NullString);
+        } else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>) {
+            out += char(LogTag::Pointer);
+            putVarint(out, reinterpret_cast<uintptr_t>(static_cast<const void*>(v)));
+        } else {
+            out += char(LogTag::String);
+            const size_t start = out.size();
+            print_detail::container_writer<std::string> ctx(out);
+            print_detail::format_object(ctx, v, spec);
+            // the length goes first, and is known now
+            std::string length;
+            putVarint(length, out.size() - start);
+            out.insert(start, length);
+        }
+    }
+
+    /// Whether `putLogArg` stores T as the text of an object.
+    template <class T>
+    constexpr bool isLogObject = !std::is_arithmetic_v<T> && !std::is_enum_v<T>
+        && !std::is_pointer_v<T> && !std::is_null_pointer_v<T>;
+
+    /** Sets `specs[i]` to the conversion of argument i in `format`, for those of the first `n`
+     *  arguments that have one. Formats with very many conversions are left out: their objects
+     *  get the flags of a plain %$.
+     **/
+    inline void logArgSpecs(const char* format, print_detail::format_spec* specs, size_t n) {
+        constexpr size_t MAX_PIECES = 64;
+        const size_t count = print_detail::parse_format(format, nullptr);
+        if (count > MAX_PIECES)
+            return;
+        print_detail::format_spec pieces[MAX_PIECES];
+        print_detail::parse_format(format, pieces);
+        for (size_t i = 0; i < count; ++i) {
+            if (pieces[i].conversion != 0 && pieces[i].arg < n)
+                specs[pieces[i].arg] = pieces[i];
+        }
+    }
+
+    /// Parses a binary log, throwing std::runtime_error where it is malformed.
+    class LogReader {
+    public:
+        LogReader(const char* p, const char* end)
+            : p_(p)
+            , end_(end) {}
+
+        bool atEnd() const { return p_ == end_; }
+        const char* position() const { return p_; }
+
+        uint8_t byte() {
+            need(1);
+            return uint8_t(*p_++);
+        }
+
+        uint64_t varint() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const uint8_t b = byte();
+                v |= uint64_t(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    return v;
+            }
+            throw std::runtime_error("binary log: varint too long");
+        }
+
+        std::string_view bytes(size_t n) {
+            need(n);
+            std::string_view s(p_, n);
+            p_ += n;
+            return s;
+        }
+
+        template <class T> T raw() {
+            T v;
+            std::memcpy(&v, bytes(sizeof(T)).data(), sizeof(T));
+            return v;
+        }
+
+        /// Thrown when the input ends in the middle of an entry.
+        struct Truncated {};
+
+    private:
+        void need(size_t n) {
+            if (size_t(end_ - p_) < n)
+                throw Truncated {};
+        }
+
+        const char* p_;
+        const char* end_;
+    };
+
+    /// Starts a line with the time in UTC and the level. The date and time to the second are
+    /// cached, log lines tend to come many in the same second.
+    class LogLinePrefix {
+    public:
+        template <class Context> void format(Context& ctx, int64_t time, LogLevel level) {
+            static constexpr const char* LEVELS[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+            const time_t seconds = time / 1000000000;
+            if (seconds != second_) {
+                struct tm t;
+                gmtime_r(&seconds, &t);
+                sprint(text_, sizeof(text_), "%04d-%02d-%02dT%02d:%02d:%02d", t.tm_year + 1900,
+                    t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+                second_ = seconds;
+            }
+            print_detail::Printf(
+                ctx, "%s.%06dZ %-5s ", text_, int(time % 1000000000 / 1000), LEVELS[int(level) & 3]);
+        }
+
+    private:
+        time_t second_ = -1;
+        char text_[32];
+    };
+
+} // namespace detail
+
+/** Turns a binary log back into text, the same lines \c Logger writes in text mode.
+ *
+ *  \example
+ *  \code
+ *  BinaryLogDecoder decoder;
+ *  std::string text;
+ *  size_t used = decoder.decode(chunk, text); // keep chunk.substr(used) for the next call
+ *  \endcode
+ **/
+class BinaryLogDecoder {
+public:
+    /** Appends the lines of the complete entries at the start of `input` to `out` and returns the
+     *  number of bytes they take. What remains is an incomplete entry, to be given again with more
+     *  input. Throws std::runtime_error if the input isn't a binary log.
+     **/
+    size_t decode(std::string_view input, std::string& out) {
+        detail::LogReader in(input.data(), input.data() + input.size());
+        const char* done = in.position();
+        print_detail::container_writer<std::string> ctx(out);
+        try {
+            if (!started_) {
+                if (std::string_view(in.bytes(sizeof(BINARY_LOG_MAGIC)))
+                    != std::string_view(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)))
+                    throw std::runtime_error("binary log: bad magic");
+                started_ = true;
+                done = in.position();
+            }
+            while (!in.atEnd()) {
+                const size_t size = out.size();
+                try {
+                    entry(in, ctx);
+                } catch (detail::LogReader::Truncated) {
+                    out.resize(size);
+                    throw;
+                }
+                done = in.position();
+            }
+        } catch (detail::LogReader::Truncated) {
+        }
+        return done - input.data();
+    }
+
+private:
+    struct Site {
+        LogLevel level;
+        std::string format;
+        std::vector<print_detail::format_spec> specs;
+        bool valid;
+    };
+
+    /// Reads a whole entry before it changes anything, so that it can be read again if it's
+    /// truncated.
+    template <class Context> void entry(detail::LogReader& in, Context& ctx) {
+        const auto kind = detail::LogEntry(in.byte());
+        if (kind == detail::LogEntry::Site) {
+            const uint64_t id = in.varint();
+            Site site;
+            site.level = LogLevel(in.byte());
+            site.format = std::string(in.bytes(in.varint()));
+            const size_t count = print_detail::parse_format(site.format, nullptr);
+            site.valid = count != SIZE_MAX;
+            if (site.valid) {
+                site.specs.resize(count);
+                print_detail::parse_format(site.format, site.specs.data());
+            }
+            sites_[id] = std::move(site);
+        } else if (kind == detail::LogEntry::Record) {
+            auto it = sites_.find(in.varint());
+            if (it == sites_.end())
+                throw std::runtime_error("binary log: record of an unknown site");
+            const Site& site = it->second;
+            const int64_t time = time_ + detail::unzigzag(in.varint());
+            args_.clear();
+            strings_.clear();
+            for (uint64_t count = in.varint(); count > 0; --count)
+                args_.push_back(value(in));
+            time_ = time;
+
+            prefix_.format(ctx, time, site.level);
+            const size_t message = ctx.c_.size();
+            try {
+                format(ctx, site);
+            } catch (const std::exception& e) {
+                ctx.c_.resize(message);
+                print_detail::Printf(ctx, "<%s in \"%s\">", e.what(), site.format.c_str());
+            }
+            ctx.write('\n');
+        } else {
+            throw std::runtime_error("binary log: unknown entry");
+        }
+    }
+
+    detail::LogValue value(detail::LogReader& in) {
+        using detail::LogTag;
+        switch (LogTag(in.byte())) {
+        case LogTag::Char:
+            if constexpr (std::is_signed_v<char>)
+                return char(detail::unzigzag(in.varint()));
+            else
+                return char(in.varint());
+        case LogTag::SignedChar:
+            return static_cast<signed char>(detail::unzigzag(in.varint()));
+        case LogTag::UnsignedChar:
+            return static_cast<unsigned char>(in.varint());
+        case LogTag::Short:
+            return short(detail::unzigzag(in.varint()));
+        case LogTag::UnsignedShort:
+            return static_cast<unsigned short>(in.varint());
+        case LogTag::Int:
+            return int(detail::unzigzag(in.varint()));
+        case LogTag::UnsignedInt:
+            return unsigned(in.varint());
+        case LogTag::Long:
+            return long(detail::unzigzag(in.varint()));
+        case LogTag::UnsignedLong:
+            return static_cast<unsigned long>(in.varint());
+        case LogTag::LongLong:
+            return static_cast<long long>(detail::unzigzag(in.varint()));
+        case LogTag::UnsignedLongLong:
+            return static_cast<unsigned long long>(in.varint());
+        case LogTag::Float:
+            return in.raw<float>();
+        case LogTag::Double:
+            return in.raw<double>();
+        case LogTag::LongDouble:
+            // written as a double, see putLogArg
+            return in.raw<double>();
+        case LogTag::Pointer:
+            return reinterpret_cast<const void*>(uintptr_t(in.varint()));
+        case LogTag::String: {
+            // copied for the terminator %s needs, where it doesn't move
+            std::string_view s = in.bytes(in.varint());
+            strings_.emplace_back(s);
+            return strings_.back().c_str();
+        }
+        case LogTag::NullString:
+            return static_cast<const char*>(nullptr);
+        }
+        throw std::runtime_error("binary log: unknown argument type");
+    }
+
+    /// Prints the arguments of a record with the parsed format, as \c Printf would.
+    template <class Context> void format(Context& ctx, const Site& site) {
+        if (!site.valid)
+            throw print_detail::format_error("Bad Format, invalid conversion specification");
+        size_t next = 0;
+        auto take = [&]() -> const detail::LogValue& {
+            if (next == args_.size())
+                print_detail::ThrowError("Bad Format, arguments < formaters");
+            return args_[next++];
+        };
+        auto integer = [](const detail::LogValue& v) {
+            return std::visit(
+                [](auto x) { return print_detail::formatted_integer<long int>(x); }, v);
+        };
+
+        for (const print_detail::format_spec& spec : site.specs) {
+            if (spec.conversion == 0) {
+                ctx.write(site.format.data() + spec.offset, spec.length);
+                continue;
+            }
+            const long int width = spec.width_arg != SIZE_MAX ? integer(take()) : spec.width;
+            const long int precision = spec.precision_arg != SIZE_MAX ? integer(take()) : spec.precision;
+            std::visit(
+                [&](const auto& arg) {
+                    print_detail::format_arg(
+                        ctx, spec.conversion, spec.flags, width, precision, spec.modifier, arg);
+                },
+                take());
+        }
+        if (next != args_.size())
+            print_detail::ThrowError("Bad Format, arguments > formaters");
+    }
+
+    bool started_ = false;
+    int64_t time_ = 0;
+    std::unordered_map<uint64_t, Site> sites_;
+    std::vector<detail::LogValue> args_;
+    std::deque<std::string> strings_;
+    detail::LogLinePrefix prefix_;
+};
+
+} // namespace ccutils
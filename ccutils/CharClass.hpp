@@ -0,0 +1,214 @@
+#pragma once
+
+#include "cpuFeatures.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace ccutils {
+
+/** A set of bytes, tested either one byte at a time with a 256-bit bitmap, or 16/32 bytes at a time with SIMD.
+ *
+ *  The SIMD test splits each byte into its low and high nibble. For every low nibble, `lo0_` holds the set of high
+ *  nibbles 0-7 that are members and `lo1_` those of 8-15, one bit each. A byte is a member when bit `hi & 7` of the
+ *  right table's entry is set, which takes two pshufb lookups, a blend on the byte's top bit and a third pshufb for
+ *  `1 << (hi & 7)`. This is exact for any set of bytes.
+ **/
+class CharClass {
+public:
+    constexpr CharClass() = default;
+
+    constexpr explicit CharClass(std::string_view chars) {
+        for (char c : chars)
+            add(c);
+    }
+
+    constexpr CharClass& add(char ch) {
+        const auto c = static_cast<unsigned char>(ch);
+        bits_[c >> 6] |= uint64_t(1) << (c & 63);
+        if (c < 0x80)
+            lo0_[c & 15] |= uint8_t(1 << (c >> 4));
+        else
+            lo1_[c & 15] |= uint8_t(1 << ((c >> 4) & 7));
+        return *this;
+    }
+
+    constexpr bool contains(char ch) const {
+        const auto c = static_cast<unsigned char>(ch);
+        return (bits_[c >> 6] >> (c & 63)) & 1;
+    }
+
+    constexpr CharClass operator~() const {
+        CharClass result;
+        for (int c = 0; c < 256; ++c) {
+            if (!contains(char(c)))
+                result.add(char(c));
+        }
+        return result;
+    }
+
+    /// The bytes std::isspace accepts in the C locale.
+    static constexpr CharClass whitespace() { return CharClass(" \t\n\v\f\r"); }
+
+#if defined(__x86_64__) || defined(__i386__)
+    /// Bit i is set if p[i] is a member, for 16 bytes.
+    CCUTILS_TARGET_SSE42 uint32_t match16(const char* p) const {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i nibble = _mm_set1_epi8(0x0f);
+        const __m128i lo = _mm_and_si128(bytes, nibble);
+        const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+        const __m128i rows = _mm_blendv_epi8(
+            _mm_shuffle_epi8(load16(lo0_), lo), _mm_shuffle_epi8(load16(lo1_), lo), bytes);
+        const __m128i bit = _mm_shuffle_epi8(load16(HIGH_BIT), hi);
+        const __m128i miss = _mm_cmpeq_epi8(_mm_and_si128(rows, bit), _mm_setzero_si128());
+        return ~uint32_t(_mm_movemask_epi8(miss)) & 0xffff;
+    }
+
+    /// Bit i is set if p[i] is a member, for 32 bytes.
+    CCUTILS_TARGET_AVX2 uint32_t match32(const char* p) const {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        const __m256i lo = _mm256_and_si256(bytes, nibble);
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+        const __m256i rows = _mm256_blendv_epi8(
+            _mm256_shuffle_epi8(load32(lo0_), lo), _mm256_shuffle_epi8(load32(lo1_), lo), bytes);
+        const __m256i bit = _mm256_shuffle_epi8(load32(HIGH_BIT), hi);
+        const __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(rows, bit), _mm256_setzero_si256());
+        return ~uint32_t(_mm256_movemask_epi8(miss));
+    }
+#endif
+
+private:
+    static constexpr uint8_t HIGH_BIT[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+
+#if defined(__x86_64__) || defined(__i386__)
+    CCUTILS_TARGET_SSE42 static __m128i load16(const uint8_t* table) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(table));
+    }
+    CCUTILS_TARGET_AVX2 static __m256i load32(const uint8_t* table) {
+        return _mm256_broadcastsi128_si256(load16(table));
+    }
+#endif
+
+    uint64_t bits_[4] = {};
+    uint8_t lo0_[16] = {};
+    uint8_t lo1_[16] = {};
+};
+
+namespace detail {
+
+    /// Index of the first byte of `[p, p + n)` that is (`member`) or isn't a member of `cls`, or n.
+    inline size_t findClassGeneric(const char* p, size_t n, const CharClass& cls, bool member) {
+        for (size_t i = 0; i < n; ++i) {
+            if (cls.contains(p[i]) == member)
+                return i;
+        }
+        return n;
+    }
+
+    /// Index of the last such byte, or n.
+    inline size_t findLastClassGeneric(const char* p, size_t n, const CharClass& cls, bool member) {
+        for (size_t i = n; i-- > 0;) {
+            if (cls.contains(p[i]) == member)
+                return i;
+        }
+        return n;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    CCUTILS_TARGET_SSE42 inline size_t findClassSse42(
+        const char* p, size_t n, const CharClass& cls, bool member) {
+        const uint32_t flip = member ? 0 : 0xffff;
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            if (uint32_t mask = cls.match16(p + i) ^ flip)
+                return i + __builtin_ctz(mask);
+        }
+        size_t tail = findClassGeneric(p + i, n - i, cls, member);
+        return i + tail;
+    }
+
+    CCUTILS_TARGET_SSE42 inline size_t findLastClassSse42(
+        const char* p, size_t n, const CharClass& cls, bool member) {
+        const uint32_t flip = member ? 0 : 0xffff;
+        size_t end = n;
+        for (; end >= 16; end -= 16) {
+            if (uint32_t mask = cls.match16(p + end - 16) ^ flip)
+                return end - 16 + 31 - __builtin_clz(mask);
+        }
+        size_t head = findLastClassGeneric(p, end, cls, member);
+        return head == end ? n : head;
+    }
+
+    CCUTILS_TARGET_AVX2 inline size_t findClassAvx2(
+        const char* p, size_t n, const CharClass& cls, bool member) {
+        const uint32_t flip = member ? 0 : ~uint32_t(0);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            if (uint32_t mask = cls.match32(p + i) ^ flip)
+                return i + __builtin_ctz(mask);
+        }
+        return i + findClassSse42(p + i, n - i, cls, member);
+    }
+
+    CCUTILS_TARGET_AVX2 inline size_t findLastClassAvx2(
+        const char* p, size_t n, const CharClass& cls, bool member) {
+        const uint32_t flip = member ? 0 : ~uint32_t(0);
+        size_t end = n;
+        for (; end >= 32; end -= 32) {
+            if (uint32_t mask = cls.match32(p + end - 32) ^ flip)
+                return end - 32 + 31 - __builtin_clz(mask);
+        }
+        size_t head = findLastClassSse42(p, end, cls, member);
+        return head == end ? n : head;
+    }
+
+    inline Dispatched<size_t(const char*, size_t, const CharClass&, bool)> findClass {
+        findClassGeneric, findClassSse42, findClassAvx2
+    };
+    inline Dispatched<size_t(const char*, size_t, const CharClass&, bool)> findLastClass {
+        findLastClassGeneric, findLastClassSse42, findLastClassAvx2
+    };
+#else
+    inline Dispatched<size_t(const char*, size_t, const CharClass&, bool)> findClass { findClassGeneric };
+    inline Dispatched<size_t(const char*, size_t, const CharClass&, bool)> findLastClass {
+        findLastClassGeneric
+    };
+#endif
+
+} // namespace detail
+
+/// Position of the first byte of `s` in `cls`, or npos.
+inline size_t findFirstOf(std::string_view s, const CharClass& cls, size_t pos = 0) {
+    if (pos >= s.size())
+        return std::string_view::npos;
+    size_t i = detail::findClass(s.data() + pos, s.size() - pos, cls, true);
+    return i == s.size() - pos ? std::string_view::npos : pos + i;
+}
+
+/// Position of the first byte of `s` not in `cls`, or npos.
+inline size_t findFirstNotOf(std::string_view s, const CharClass& cls, size_t pos = 0) {
+    if (pos >= s.size())
+        return std::string_view::npos;
+    size_t i = detail::findClass(s.data() + pos, s.size() - pos, cls, false);
+    return i == s.size() - pos ? std::string_view::npos : pos + i;
+}
+
+/// Position of the last byte of `s` in `cls`, or npos.
+inline size_t findLastOf(std::string_view s, const CharClass& cls) {
+    size_t i = detail::findLastClass(s.data(), s.size(), cls, true);
+    return i == s.size() ? std::string_view::npos : i;
+}
+
+/// Position of the last byte of `s` not in `cls`, or npos.
+inline size_t findLastNotOf(std::string_view s, const CharClass& cls) {
+    size_t i = detail::findLastClass(s.data(), s.size(), cls, false);
+    return i == s.size() ? std::string_view::npos : i;
+}
+
+} // namespace ccutils
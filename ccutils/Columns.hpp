@@ -9,34 +9,159 @@
 
 #pragma once
 
+#include "CharClass.hpp"
+#include "ThreadPool.hpp"
+#include "Utf8.hpp"
+
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <ostream>
-#include <sstream>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace ccutils {
 
 inline auto isWhitespace(char c) -> bool {
-    static std::string chars = " \t\n\r";
-    return chars.find(c) != std::string::npos;
+    static constexpr CharClass chars(" \t\n\r");
+    return chars.contains(c);
 }
 inline auto isBreakableBefore(char c) -> bool {
-    static std::string chars = "[({<|";
-    return chars.find(c) != std::string::npos;
+    static constexpr CharClass chars("[({<|");
+    return chars.contains(c);
 }
 inline auto isBreakableAfter(char c) -> bool {
-    static std::string chars = "])}>.,:;*+-=&/\\";
-    return chars.find(c) != std::string::npos;
+    static constexpr CharClass chars("])}>.,:;*+-=&/\\");
+    return chars.contains(c);
 }
 
 class Columns;
+class TableWriter;
+
+/// One line of a laid out \c Column: `indent` spaces, then `length` bytes of string `string` of the
+/// column from `offset`, which take `columns` columns on a terminal, then a '-' if a word was split
+/// there. Kept to 24 bytes, as there is one for every line of a table.
+struct ColumnLine {
+    size_t offset;
+    uint32_t length;
+    uint32_t columns;
+    uint32_t string;
+    uint16_t indent;
+    bool suffix;
+
+    /// Its length in bytes.
+    auto size() const -> size_t { return indent + length + suffix; }
+    /// The columns it takes on a terminal.
+    auto width() const -> size_t { return indent + columns + suffix; }
+};
 
 class Column {
+    friend TableWriter;
+
     std::vector<std::string> m_strings;
     size_t m_width = 80;
     size_t m_indent = 0;
     size_t m_initialIndent = std::string::npos;
 
+    static auto isBoundary(std::string_view text, size_t at) -> bool {
+        assert(at > 0);
+        assert(at <= text.size());
+
+        return at == text.size() || (isWhitespace(text[at]) && !isWhitespace(text[at - 1]))
+            || isBreakableBefore(text[at]) || isBreakableAfter(text[at - 1])
+            || (((text[at] | text[at - 1]) & 0x80) && isWideBoundary(text, at));
+    }
+
+    /// Whether `at` is between two code points and one of them is wide, as ideographs are, which
+    /// wrap anywhere, unless the one after is a combining mark.
+    static auto isWideBoundary(std::string_view text, size_t at) -> bool {
+        if (isUtf8Continuation(text[at]))
+            return false;
+        char32_t cp;
+        decodeUtf8(text.data() + at, text.size() - at, cp);
+        const int after = codePointWidth(cp);
+        if (after != 1)
+            return after == 2;
+        size_t start = at - 1;
+        while (start > 0 && at - start < 4 && isUtf8Continuation(text[start]))
+            --start;
+        decodeUtf8(text.data() + start, at - start, cp);
+        return codePointWidth(cp) == 2;
+    }
+
+    /** The line of `text` that starts at `pos`, where `newline` is the end of the paragraph it is
+     *  in: the next '\n' or the end of the string. It is the paragraph if it fits in `width`, or
+     *  else the longest piece ending at a word boundary, with a word split only if there is none.
+     *  Widths are in terminal columns of UTF-8 text, and pieces end between code points.
+     **/
+    static auto breakLine(std::string_view text, size_t pos, size_t newline, size_t width)
+        -> ColumnLine {
+        std::string_view paragraph = text.substr(pos, newline - pos);
+        const DisplayFit fit = fitDisplayWidth(paragraph, width);
+        ColumnLine line { pos, uint32_t(fit.bytes), uint32_t(fit.columns), 0, 0, false };
+
+        if (fit.bytes < paragraph.size() || fit.columns >= width) {
+            size_t len = fit.bytes;
+            while (len > 0 && !isBoundary(text, pos + len))
+                --len;
+            while (len > 0 && isWhitespace(text[pos + len - 1]))
+                --len;
+
+            if (len > 0) {
+                line.length = len;
+                // as many bytes as columns means only ASCII or invalid bytes, one column each
+                line.columns -= fit.columns == fit.bytes
+                    ? fit.bytes - len
+                    : displayWidth(paragraph.substr(len, fit.bytes - len));
+            } else {
+                // split the word, or at least take its first character when even that is too wide
+                const DisplayFit split = fitDisplayWidth(paragraph, width - 1);
+                if (split.bytes > 0) {
+                    line.suffix = true;
+                    line.length = split.bytes;
+                    line.columns = split.columns;
+                } else {
+                    char32_t cp;
+                    decodeUtf8(paragraph.data(), paragraph.size(), cp);
+                    const DisplayFit first = fitDisplayWidth(paragraph, size_t(codePointWidth(cp)));
+                    line.length = first.bytes;
+                    line.columns = first.columns;
+                }
+            }
+        }
+        return line;
+    }
+
+    /// The line of string `index` that starts at `pos`, as \c breakLine finds it in the width left
+    /// after the indent.
+    auto lineAt(size_t index, size_t pos, size_t newline) const -> ColumnLine {
+        const size_t indent = pos == 0 && index == 0 && m_initialIndent != std::string::npos
+            ? m_initialIndent
+            : m_indent;
+        ColumnLine line = breakLine(m_strings[index], pos, newline, m_width - indent);
+        line.string = uint32_t(index);
+        line.indent = uint16_t(indent);
+        return line;
+    }
+
+    /// Where the line after `line` starts: past a newline, or else past the spaces at the break.
+    static auto nextLine(std::string_view text, ColumnLine const& line) -> size_t {
+        size_t pos = line.offset + line.length;
+        if (pos < text.size() && text[pos] == '\n')
+            return pos + 1;
+        while (pos < text.size() && isWhitespace(text[pos]))
+            ++pos;
+        return pos;
+    }
+
+    static auto paragraphEnd(std::string_view text, size_t pos) -> size_t {
+        if (pos >= text.size())
+            return text.size();
+        const void* newline = std::memchr(text.data() + pos, '\n', text.size() - pos);
+        return newline ? static_cast<const char*>(newline) - text.data() : text.size();
+    }
+
 public:
     class iterator {
         friend Column;
@@ -44,10 +169,8 @@ public:
         Column const& m_column;
         size_t m_stringIndex = 0;
         size_t m_pos = 0;
-
-        size_t m_len = 0;
-        size_t m_end = 0;
-        bool m_suffix = false;
+        size_t m_newline = 0;
+        ColumnLine m_line {};
 
         iterator(Column const& column, size_t stringIndex)
             : m_column(column)
@@ -55,50 +178,12 @@ public:
 
         auto line() const -> std::string const& { return m_column.m_strings[m_stringIndex]; }
 
-        auto isBoundary(size_t at) const -> bool {
-            assert(at > 0);
-            assert(at <= line().size());
-
-            return at == line().size()
-                || (isWhitespace(line()[at]) && !isWhitespace(line()[at - 1]))
-                || isBreakableBefore(line()[at]) || isBreakableAfter(line()[at - 1]);
-        }
-
         void calcLength() {
             assert(m_stringIndex < m_column.m_strings.size());
 
-            m_suffix = false;
-            auto width = m_column.m_width - indent();
-            m_end = m_pos;
-            while (m_end < line().size() && line()[m_end] != '\n')
-                ++m_end;
-
-            if (m_end < m_pos + width) {
-                m_len = m_end - m_pos;
-            } else {
-                size_t len = width;
-                while (len > 0 && !isBoundary(m_pos + len))
-                    --len;
-                while (len > 0 && isWhitespace(line()[m_pos + len - 1]))
-                    --len;
-
-                if (len > 0) {
-                    m_len = len;
-                } else {
-                    m_suffix = true;
-                    m_len = width - 1;
-                }
-            }
-        }
-
-        auto indent() const -> size_t {
-            auto initial
-                = m_pos == 0 && m_stringIndex == 0 ? m_column.m_initialIndent : std::string::npos;
-            return initial == std::string::npos ? m_column.m_indent : initial;
-        }
-
-        auto addIndentAndSuffix(std::string const& plain) const -> std::string {
-            return std::string(indent(), ' ') + (m_suffix ? plain + "-" : plain);
+            if (m_pos == 0 || m_newline < m_pos)
+                m_newline = paragraphEnd(line(), m_pos);
+            m_line = m_column.lineAt(m_stringIndex, m_pos, m_newline);
         }
 
     public:
@@ -107,28 +192,23 @@ public:
             assert(m_column.m_width > m_column.m_indent);
             assert(m_column.m_initialIndent == std::string::npos
                 || m_column.m_width > m_column.m_initialIndent);
-            calcLength();
-            if (m_len == 0)
+            if (line().empty())
                 m_stringIndex++; // Empty string
+            else
+                calcLength();
         }
 
         auto operator*() const -> std::string {
             assert(m_stringIndex < m_column.m_strings.size());
-            assert(m_pos <= m_end);
-            if (m_pos + m_column.m_width < m_end)
-                return addIndentAndSuffix(line().substr(m_pos, m_len));
-            else
-                return addIndentAndSuffix(line().substr(m_pos, m_end - m_pos));
+            std::string result(m_line.indent, ' ');
+            result.append(line(), m_line.offset, m_line.length);
+            if (m_line.suffix)
+                result += '-';
+            return result;
         }
 
         auto operator++() -> iterator& {
-            m_pos += m_len;
-            if (m_pos < line().size() && line()[m_pos] == '\n')
-                m_pos += 1;
-            else
-                while (m_pos < line().size() && isWhitespace(line()[m_pos]))
-                    ++m_pos;
-
+            m_pos = nextLine(line(), m_line);
             if (m_pos == line().size()) {
                 m_pos = 0;
                 ++m_stringIndex;
@@ -171,24 +251,71 @@ public:
     auto begin() const -> iterator { return iterator(*this); }
     auto end() const -> iterator { return { *this, m_strings.size() }; }
 
-    inline friend std::ostream& operator<<(std::ostream& os, Column const& col) {
-        bool first = true;
-        for (auto line : col) {
-            if (first)
-                first = false;
-            else
-                os << "\n";
-            os << line;
+    /// The string a \c ColumnLine of this column points into.
+    auto text(ColumnLine const& line) const -> std::string_view { return m_strings[line.string]; }
+
+    /** Appends the lines of the column to `lines`, the same as its iterators give, in a single
+     *  pass over the text.
+     **/
+    void layout(std::vector<ColumnLine>& lines) const {
+        assert(m_width > m_indent);
+        assert(m_initialIndent == std::string::npos || m_width > m_initialIndent);
+        for (size_t i = 0; i < m_strings.size(); ++i) {
+            std::string_view text = m_strings[i];
+            if (i == 0 && text.empty())
+                continue;
+            size_t pos = 0;
+            size_t newline = paragraphEnd(text, 0);
+            do {
+                if (newline < pos)
+                    newline = paragraphEnd(text, pos);
+                lines.push_back(lineAt(i, pos, newline));
+                pos = nextLine(text, lines.back());
+            } while (pos < text.size());
+        }
+    }
+
+    /// Writes `line` at `out`, which has room for its size.
+    auto write(char* out, ColumnLine const& line) const -> char* {
+        std::memset(out, ' ', line.indent);
+        out += line.indent;
+        std::memcpy(out, m_strings[line.string].data() + line.offset, line.length);
+        out += line.length;
+        if (line.suffix)
+            *out++ = '-';
+        return out;
+    }
+
+    /// Appends the column to `out`, its lines separated by newlines.
+    void render(std::string& out) const {
+        std::vector<ColumnLine> lines;
+        layout(lines);
+        size_t size = lines.empty() ? 0 : lines.size() - 1;
+        for (auto const& line : lines)
+            size += line.size();
+
+        size_t start = out.size();
+        out.resize(start + size);
+        char* p = &out[start];
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (i != 0)
+                *p++ = '\n';
+            p = write(p, lines[i]);
         }
-        return os;
+    }
+
+    inline friend std::ostream& operator<<(std::ostream& os, Column const& col) {
+        std::string text;
+        col.render(text);
+        return os.write(text.data(), text.size());
     }
 
     auto operator+(Column const& other) -> Columns;
 
     auto toString() const -> std::string {
-        std::ostringstream oss;
-        oss << *this;
-        return oss.str();
+        std::string text;
+        render(text);
+        return text;
     }
 };
 
@@ -245,8 +372,9 @@ public:
                 if (m_iterators[i] != m_columns[i].end()) {
                     std::string col = *m_iterators[i];
                     row += padding + col;
-                    if (col.size() < width)
-                        padding = std::string(width - col.size(), ' ');
+                    const size_t columns = displayWidth(col);
+                    if (columns < width)
+                        padding = std::string(width - columns, ' ');
                     else
                         padding = "";
                 } else {
@@ -273,6 +401,55 @@ public:
     auto begin() const -> iterator { return iterator(*this); }
     auto end() const -> iterator { return { *this, iterator::EndTag() }; }
 
+    /// Rows rendered together; tables with more than one block render them in parallel.
+    static constexpr size_t RENDER_BLOCK_ROWS = 4096;
+
+    /** Appends the rows to `out`, separated by newlines, the same as the iterators give. Each
+     *  column is laid out once, then the size of every row is known, and so where it goes: `out`
+     *  grows once and blocks of rows are written straight in their place, on
+     *  \c ThreadPool::global() for large tables.
+     **/
+    void render(std::string& out) const {
+        std::vector<std::vector<ColumnLine>> lines(m_columns.size());
+        size_t rows = 0;
+        for (size_t i = 0; i < m_columns.size(); ++i) {
+            m_columns[i].layout(lines[i]);
+            rows = std::max(rows, lines[i].size());
+        }
+        if (rows == 0)
+            return;
+
+        // where each row starts, after the newline ending the one before
+        std::vector<size_t> offsets(rows);
+        size_t size = 0;
+        for (size_t row = 0; row < rows; ++row) {
+            offsets[row] = size;
+            size += forEachLine(lines, row, [](size_t, size_t, ColumnLine const&) {}) + 1;
+        }
+
+        const size_t start = out.size();
+        out.resize(start + size - 1);
+        char* base = &out[start];
+        auto renderBlock = [&](size_t block) {
+            const size_t last = std::min(rows, (block + 1) * RENDER_BLOCK_ROWS);
+            for (size_t row = block * RENDER_BLOCK_ROWS; row < last; ++row) {
+                char* p = base + offsets[row];
+                forEachLine(lines, row, [&](size_t column, size_t padding, ColumnLine const& line) {
+                    std::memset(p, ' ', padding);
+                    p = m_columns[column].write(p + padding, line);
+                });
+                if (row + 1 < rows)
+                    *p = '\n';
+            }
+        };
+
+        const size_t blocks = (rows + RENDER_BLOCK_ROWS - 1) / RENDER_BLOCK_ROWS;
+        if (blocks > 1)
+            ThreadPool::global().parallelFor(0, blocks, renderBlock);
+        else
+            renderBlock(0);
+    }
+
     auto operator+=(Column const& col) -> Columns& {
         m_columns.push_back(col);
         return *this;
@@ -284,21 +461,42 @@ public:
     }
 
     inline friend std::ostream& operator<<(std::ostream& os, Columns const& cols) {
-        bool first = true;
-        for (auto line : cols) {
-            if (first)
-                first = false;
-            else
-                os << "\n";
-            os << line;
-        }
-        return os;
+        std::string text;
+        cols.render(text);
+        return os.write(text.data(), text.size());
     }
 
     auto toString() const -> std::string {
-        std::ostringstream oss;
-        oss << *this;
-        return oss.str();
+        std::string text;
+        render(text);
+        return text;
+    }
+
+private:
+    /** Calls `f(column, padding, line)` for the columns with a line in `row`, with the spaces
+     *  that go before it, and returns the length of the row in bytes. Each column takes its width
+     *  in terminal columns, unless its line is wider, and the spaces after the last line are left
+     *  out.
+     **/
+    template <class F>
+    auto forEachLine(std::vector<std::vector<ColumnLine>> const& lines, size_t row, F&& f) const
+        -> size_t {
+        size_t start = 0;
+        size_t end = 0;
+        size_t bytes = 0;
+        for (size_t i = 0; i < m_columns.size(); ++i) {
+            const size_t width = m_columns[i].width();
+            if (row < lines[i].size()) {
+                ColumnLine const& line = lines[i][row];
+                f(i, start - end, line);
+                bytes += start - end + line.size();
+                end = start + line.width();
+                start = std::max(end, start + width);
+            } else {
+                start += width;
+            }
+        }
+        return bytes;
     }
 };
 
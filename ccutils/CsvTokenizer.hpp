@@ -0,0 +1,287 @@
+#pragma once
+
+/** Tokenizing of delimited text (CSV, TSV) with RFC 4180 quoting.
+ *
+ * Input is classified 64 bytes at a time, as in simdjson's first stage: SIMD compares give one
+ * bitmask each for quotes, delimiters and newlines, a prefix XOR of the quote mask marks the bytes
+ * inside quoted fields, and what remains of the delimiter and newline masks are the field
+ * boundaries. Fields are then popped off the mask one by one, without looking at the bytes in
+ * between.
+ *
+ * Rows end with "\n" or "\r\n". A quoted field may contain delimiters, newlines and doubled
+ * quotes. Fields are views into the input, with the enclosing quotes removed but doubled quotes
+ * left as they are, see \c CsvField::unescaped.
+ */
+
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ccutils {
+
+struct CsvDialect {
+    char delimiter = ',';
+    char quote = '"';
+};
+
+/// A comma separated dialect and a tab separated one.
+static constexpr CsvDialect CSV_DIALECT = { ',', '"' };
+static constexpr CsvDialect TSV_DIALECT = { '\t', '"' };
+
+struct CsvField {
+    /// The field without its enclosing quotes. Quotes inside are still doubled.
+    std::string_view data;
+    bool quoted = false;
+
+    /// The field with doubled quotes collapsed. Only quoted fields ever need it.
+    std::string unescaped(char quote = '"') const {
+        std::string result;
+        result.reserve(data.size());
+        for (size_t i = 0; i < data.size(); ++i) {
+            result += data[i];
+            if (quoted && data[i] == quote && i + 1 < data.size() && data[i + 1] == quote)
+                ++i;
+        }
+        return result;
+    }
+};
+
+namespace detail {
+
+    static constexpr size_t CSV_BLOCK = 64;
+
+    /// Bit i is set if p[i] == byte, for a full block.
+    inline uint64_t csvMatch(const char* p, char byte) {
+#if defined(__AVX2__)
+        const __m256i needle = _mm256_set1_epi8(byte);
+        uint64_t lo = uint32_t(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), needle)));
+        uint64_t hi = uint32_t(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), needle)));
+        return lo | hi << 32;
+#elif defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi8(byte);
+        uint64_t mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+            mask |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)))) << (16 * i);
+        }
+        return mask;
+#else
+        uint64_t mask = 0;
+        for (size_t i = 0; i < CSV_BLOCK; ++i)
+            mask |= uint64_t(p[i] == byte) << i;
+        return mask;
+#endif
+    }
+
+    /// Bit i is set if an odd number of bits at or below i are set in x.
+    inline uint64_t prefixXor(uint64_t x) {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    /** Classifies a block of input. `inQuote` is all ones if the block starts inside a quoted field
+     *  and is updated for the next block. Returns the unquoted delimiters and newlines.
+     **/
+    class CsvClassifier {
+    public:
+        explicit CsvClassifier(CsvDialect dialect)
+            : dialect_(dialect) {}
+
+        /// Works on `n` bytes, any number; bits past `n` are never set.
+        uint64_t structural(const char* p, size_t n, uint64_t& inQuote) const {
+            uint64_t quote, separator;
+            if (n >= CSV_BLOCK) {
+                quote = csvMatch(p, dialect_.quote);
+                separator = csvMatch(p, dialect_.delimiter) | csvMatch(p, '\n');
+            } else {
+                char block[CSV_BLOCK];
+                std::memcpy(block, p, n);
+                std::memset(block + n, 0, CSV_BLOCK - n);
+                const uint64_t valid = n ? ~uint64_t(0) >> (CSV_BLOCK - n) : 0;
+                quote = csvMatch(block, dialect_.quote) & valid;
+                separator = (csvMatch(block, dialect_.delimiter) | csvMatch(block, '\n')) & valid;
+            }
+            const uint64_t inside = prefixXor(quote) ^ inQuote;
+            inQuote = uint64_t(int64_t(inside) >> 63);
+            return separator & ~inside;
+        }
+
+        /// Number of quotes in `[p, p + n)`, which is all it takes to know the quoting state after them.
+        size_t countQuotes(const char* p, size_t n) const {
+            size_t count = 0;
+            size_t i = 0;
+            for (; i + CSV_BLOCK <= n; i += CSV_BLOCK)
+                count += __builtin_popcountll(csvMatch(p + i, dialect_.quote));
+            return count + std::count(p + i, p + n, dialect_.quote);
+        }
+
+    private:
+        CsvDialect dialect_;
+    };
+
+} // namespace detail
+
+/** Reads rows out of delimited text one at a time. The input must outlive the fields.
+ *
+ *  \example
+ *  \code
+ *  MappedFile file("data.csv");
+ *  CsvTokenizer tokenizer(file.view());
+ *  std::vector<CsvField> row;
+ *  while (tokenizer.nextRow(row))
+ *      consume(row[0].data);
+ *  \endcode
+ **/
+class CsvTokenizer {
+public:
+    explicit CsvTokenizer(std::string_view input, CsvDialect dialect = CSV_DIALECT)
+        : classifier_(dialect)
+        , dialect_(dialect)
+        , pos_(input.data())
+        , block_(input.data())
+        , end_(input.data() + input.size()) {
+        if (pos_ != end_)
+            mask_ = classifier_.structural(block_, end_ - block_, inQuote_);
+    }
+
+    /** Replaces the contents of `row` with the fields of the next row. Returns false once the input
+     *  is exhausted. An empty line is a row with a single empty field.
+     **/
+    bool nextRow(std::vector<CsvField>& row) {
+        row.clear();
+        if (pos_ == end_)
+            return false;
+        while (true) {
+            const char* boundary = nextBoundary();
+            if (boundary == end_ || *boundary == '\n') {
+                const char* last = boundary;
+                if (last != pos_ && last[-1] == '\r')
+                    --last;
+                row.push_back(field(pos_, last));
+                pos_ = boundary == end_ ? end_ : boundary + 1;
+                return true;
+            }
+            row.push_back(field(pos_, boundary));
+            pos_ = boundary + 1;
+        }
+    }
+
+private:
+    const char* nextBoundary() {
+        while (mask_ == 0) {
+            if (end_ - block_ <= static_cast<ptrdiff_t>(detail::CSV_BLOCK))
+                return end_;
+            block_ += detail::CSV_BLOCK;
+            mask_ = classifier_.structural(block_, end_ - block_, inQuote_);
+        }
+        const char* boundary = block_ + __builtin_ctzll(mask_);
+        mask_ &= mask_ - 1;
+        return boundary;
+    }
+
+    CsvField field(const char* begin, const char* end) const {
+        if (end - begin >= 2 && *begin == dialect_.quote && end[-1] == dialect_.quote)
+            return { std::string_view(begin + 1, end - begin - 2), true };
+        return { std::string_view(begin, end - begin), false };
+    }
+
+    detail::CsvClassifier classifier_;
+    CsvDialect dialect_;
+    const char* pos_;
+    const char* block_;
+    const char* end_;
+    uint64_t mask_ = 0;
+    uint64_t inQuote_ = 0;
+};
+
+static constexpr size_t CSV_CHUNK_SIZE = 4 << 20;
+
+/** Cuts `input` into pieces of about `chunk_size` bytes that each start at the beginning of a row,
+ *  so that each one can be given to its own \c CsvTokenizer.
+ *
+ *  A newline only ends a row if it is outside quotes, which depends on everything before it. The
+ *  quotes of every chunk are counted in parallel first; their running parity tells whether each
+ *  chunk starts inside a quoted field, and then each chunk looks for its first row boundary in
+ *  parallel as well. The pieces don't depend on the number of threads.
+ **/
+inline std::vector<std::string_view> splitCsvRows(std::string_view input, CsvDialect dialect = CSV_DIALECT,
+    size_t chunk_size = CSV_CHUNK_SIZE, ThreadPool& pool = ThreadPool::global()) {
+    if (input.empty())
+        return {};
+    chunk_size = std::max<size_t>(chunk_size, detail::CSV_BLOCK);
+    const size_t chunks = (input.size() + chunk_size - 1) / chunk_size;
+    const detail::CsvClassifier classifier(dialect);
+
+    std::vector<uint64_t> inQuote(chunks);
+    pool.parallelFor(1, chunks, [&](size_t i) {
+        inQuote[i] = classifier.countQuotes(input.data() + (i - 1) * chunk_size, chunk_size) & 1;
+    });
+    for (size_t i = 1; i < chunks; ++i)
+        inQuote[i] = (inQuote[i] ^ inQuote[i - 1]) & 1;
+    for (uint64_t& quoted : inQuote)
+        quoted = quoted ? ~uint64_t(0) : 0;
+
+    // starts[i] is where the first row that starts in chunk i or later begins.
+    std::vector<size_t> starts(chunks + 1, input.size());
+    starts[0] = 0;
+    pool.parallelFor(1, chunks, [&](size_t i) {
+        uint64_t quoted = inQuote[i];
+        for (size_t block = i * chunk_size; block < input.size(); block += detail::CSV_BLOCK) {
+            const char* p = input.data() + block;
+            uint64_t mask = classifier.structural(p, input.size() - block, quoted);
+            while (mask) {
+                const size_t at = __builtin_ctzll(mask);
+                if (p[at] == '\n') {
+                    starts[i] = block + at + 1;
+                    return;
+                }
+                mask &= mask - 1;
+            }
+        }
+    });
+
+    std::vector<std::string_view> pieces;
+    for (size_t i = 0; i < chunks; ++i) {
+        if (starts[i + 1] > starts[i])
+            pieces.push_back(input.substr(starts[i], starts[i + 1] - starts[i]));
+    }
+    return pieces;
+}
+
+/** Calls `f(piece, row)` for every row of `input`, tokenizing the pieces from \c splitCsvRows in
+ *  parallel. Calls for different pieces run concurrently; rows within a piece come in order, and
+ *  pieces are numbered in input order, so results can be merged deterministically.
+ **/
+template <typename F>
+void parallelForEachCsvRow(std::string_view input, F&& f, CsvDialect dialect = CSV_DIALECT,
+    size_t chunk_size = CSV_CHUNK_SIZE, ThreadPool& pool = ThreadPool::global()) {
+    const std::vector<std::string_view> pieces = splitCsvRows(input, dialect, chunk_size, pool);
+    pool.parallelFor(0, pieces.size(), [&](size_t i) {
+        CsvTokenizer tokenizer(pieces[i], dialect);
+        std::vector<CsvField> row;
+        while (tokenizer.nextRow(row))
+            f(i, std::as_const(row));
+    });
+}
+
+} // namespace ccutils
@@ -1,8 +1,11 @@
 // https://github.com/adishavit/argh
 #pragma once
 
+#include "parse.hpp"
+
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <map>
 #include <set>
 #include <sstream>
@@ -253,11 +256,21 @@ inline string_stream Flags::bad_stream() const {
 //////////////////////////////////////////////////////////////////////////
 
 inline bool Flags::is_number(std::string const& arg) const {
-    // inefficient but simple way to determine if a string is a number (which can start with a '-')
-    std::istringstream istr(arg);
+    // a number can start with a '-' or '+'; like the stream extraction this used to be, only a prefix has to
+    // parse, but it has to start with digits or a '.' and a digit, so that -info or -nanos stay flags
+    const char* p = arg.data();
+    const char* end = p + arg.size();
+    if (p != end && *p == '+')
+        ++p;
+    const char* digits = p != end && *p == '-' && p == arg.data() ? p + 1 : p;
+    auto isDigit = [&](const char* q) { return q < end && *q >= '0' && *q <= '9'; };
+    if (!isDigit(digits) && !(digits < end && *digits == '.' && isDigit(digits + 1)))
+        return false;
     double number;
-    istr >> number;
-    return !(istr.fail() || istr.bad());
+    const auto result = parseDouble(p, end, number);
+    // the stream took an 'e' without an exponent after it, and failed
+    const bool danglingExponent = result.ptr < end && (*result.ptr == 'e' || *result.ptr == 'E');
+    return result.ec == std::errc() && std::isfinite(number) && !danglingExponent;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,599 @@
+#pragma once
+
+/** An open-addressing hash map in the style of Swiss tables (abseil's flat_hash_map).
+ *
+ * Slots are split into groups of 16. Every slot has a control byte which is either a marker
+ * (empty, deleted) or the low 7 bits of the hash of the key stored there (h2). A lookup picks a
+ * group from the high bits of the hash (h1), compares all 16 control bytes against h2 with a
+ * single SSE2 instruction and only touches the slots whose control byte matches. The probe
+ * sequence walks groups quadratically and stops at the first group that has an empty slot.
+ *
+ * Deletion leaves a tombstone only if the slot's group is full: a group that still has an empty
+ * slot never had a probe sequence pass through it, so the slot can simply become empty again.
+ *
+ * The default hasher is keyed with a per-process seed, so the layout of a table cannot be
+ * predicted from outside the process (hash flooding).
+ */
+
+#include "SipHash.hpp"
+#include "macros.hpp"
+#include "randomSeed.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ccutils {
+
+/// Seed of the default hash functions. Computed once per process.
+struct HashSeed {
+    uint64_t k0;
+    uint64_t k1;
+};
+
+inline const HashSeed& processHashSeed() {
+    static const HashSeed seed = [] {
+        uint64_t k0 = randomSeed();
+        SipHash hash(k0, ~k0);
+        hash.update(&k0);
+        return HashSeed{ k0, hash.get64() };
+    }();
+    return seed;
+}
+
+/// 64x64 -> 128 multiplication folded back to 64 bits. Cheap and good enough to mix integer keys
+/// together with a secret.
+inline uint64_t hashMum(uint64_t a, uint64_t b) {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+inline uint64_t hashMix(uint64_t x) {
+    const HashSeed& seed = processHashSeed();
+    return hashMum(x ^ seed.k0, 0x9e3779b97f4a7c15ULL ^ seed.k1);
+}
+
+/** Default hasher of FlatHashMap.
+ *
+ *  Strings go through SipHash keyed with the process seed. Everything else is hashed with
+ *  std::hash (so types made hashable with MAKE_HASHABLE work as is) and then mixed with the seed.
+ **/
+template <typename T, typename = void> struct DefaultHash {
+    size_t operator()(const T& x) const { return hashMix(std::hash<T>{}(x)); }
+};
+
+template <typename T>
+struct DefaultHash<T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>> {
+    size_t operator()(T x) const { return hashMix(static_cast<uint64_t>(x)); }
+};
+
+template <typename T> struct DefaultHash<T*> {
+    size_t operator()(T* x) const { return hashMix(reinterpret_cast<uintptr_t>(x)); }
+};
+
+template <> struct DefaultHash<std::string_view> {
+    size_t operator()(std::string_view s) const {
+        const HashSeed& seed = processHashSeed();
+        SipHash hash(seed.k0, seed.k1);
+        hash.update(s.data(), s.size());
+        return hash.get64();
+    }
+};
+
+template <> struct DefaultHash<std::string> : DefaultHash<std::string_view> {};
+
+namespace detail {
+
+    /// Control byte values. Full slots hold h2, which is in [0, 127].
+    enum Ctrl : int8_t {
+        kEmpty = -128,
+        kDeleted = -2,
+    };
+
+    struct Group {
+        static constexpr size_t kWidth = 16;
+
+#ifdef __SSE2__
+        explicit Group(const int8_t* pos)
+            : ctrl(_mm_load_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+        uint32_t match(int8_t h2) const {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+        }
+
+        uint32_t matchEmpty() const {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(kEmpty), ctrl));
+        }
+
+        /// Both markers have the sign bit set, full slots don't.
+        uint32_t matchEmptyOrDeleted() const { return _mm_movemask_epi8(ctrl); }
+
+        uint32_t matchFull() const { return matchEmptyOrDeleted() ^ 0xffff; }
+
+        __m128i ctrl;
+#else
+        explicit Group(const int8_t* pos) { std::memcpy(ctrl, pos, kWidth); }
+
+        template <typename Pred> uint32_t matchIf(Pred pred) const {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < kWidth; ++i)
+                mask |= static_cast<uint32_t>(pred(ctrl[i])) << i;
+            return mask;
+        }
+
+        uint32_t match(int8_t h2) const {
+            return matchIf([h2](int8_t c) { return c == h2; });
+        }
+        uint32_t matchEmpty() const {
+            return matchIf([](int8_t c) { return c == kEmpty; });
+        }
+        uint32_t matchEmptyOrDeleted() const {
+            return matchIf([](int8_t c) { return c < 0; });
+        }
+        uint32_t matchFull() const { return matchEmptyOrDeleted() ^ 0xffff; }
+
+        int8_t ctrl[kWidth];
+#endif
+    };
+
+    inline size_t h1(size_t hash) { return hash >> 7; }
+    inline int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7f); }
+
+    /// Holds a function object as a base where it can, so that an empty one takes no space (the
+    /// empty base optimization; an empty member still takes a byte in C++17). `Tag` keeps the
+    /// hasher and the key equality apart when they are of the same type.
+    template <typename F, int Tag, bool = std::is_empty_v<F> && !std::is_final_v<F>>
+    class FunctionHolder : private F {
+    public:
+        FunctionHolder() = default;
+        explicit FunctionHolder(F f)
+            : F(std::move(f)) {}
+
+        F& function() { return *this; }
+        const F& function() const { return *this; }
+    };
+
+    template <typename F, int Tag> class FunctionHolder<F, Tag, false> {
+    public:
+        FunctionHolder() = default;
+        explicit FunctionHolder(F f)
+            : f_(std::move(f)) {}
+
+        F& function() { return f_; }
+        const F& function() const { return f_; }
+
+    private:
+        F f_;
+    };
+
+} // namespace detail
+
+template <typename K, typename V, typename Hash = DefaultHash<K>, typename Eq = std::equal_to<K>>
+class FlatHashMap : private detail::FunctionHolder<Hash, 0>, private detail::FunctionHolder<Eq, 1> {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = Eq;
+
+private:
+    using Group = detail::Group;
+    using HashHolder = detail::FunctionHolder<Hash, 0>;
+    using EqHolder = detail::FunctionHolder<Eq, 1>;
+
+    /// The stored pair is accessed through its mutable alias when the table moves it around.
+    union Slot {
+        Slot() {}
+        ~Slot() {}
+        value_type value;
+        std::pair<K, V> mutable_value;
+    };
+
+    template <bool Const> class Iterator {
+        friend class FlatHashMap;
+        friend class Iterator<!Const>;
+        using SlotPtr = std::conditional_t<Const, const Slot*, Slot*>;
+
+        Iterator(const int8_t* ctrl, const int8_t* ctrl_end, SlotPtr slot)
+            : ctrl_(ctrl)
+            , ctrl_end_(ctrl_end)
+            , slot_(slot) {}
+
+        void skipEmpty() {
+            while (ctrl_ != ctrl_end_ && *ctrl_ < 0) {
+                ++ctrl_;
+                ++slot_;
+            }
+        }
+
+        const int8_t* ctrl_ = nullptr;
+        const int8_t* ctrl_end_ = nullptr;
+        SlotPtr slot_ = nullptr;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+        Iterator() = default;
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        Iterator(const Iterator<false>& other)
+            : ctrl_(other.ctrl_)
+            , ctrl_end_(other.ctrl_end_)
+            , slot_(other.slot_) {}
+
+        reference operator*() const { return slot_->value; }
+        pointer operator->() const { return &slot_->value; }
+
+        Iterator& operator++() {
+            ++ctrl_;
+            ++slot_;
+            skipEmpty();
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator prev(*this);
+            operator++();
+            return prev;
+        }
+
+        bool operator==(const Iterator& other) const { return ctrl_ == other.ctrl_; }
+        bool operator!=(const Iterator& other) const { return ctrl_ != other.ctrl_; }
+    };
+
+public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    FlatHashMap() = default;
+
+    explicit FlatHashMap(size_t bucket_count, const Hash& hash = Hash(), const Eq& eq = Eq())
+        : HashHolder(hash)
+        , EqHolder(eq) {
+        reserve(bucket_count);
+    }
+
+    FlatHashMap(std::initializer_list<value_type> init)
+        : FlatHashMap(init.size()) {
+        for (const auto& v : init)
+            insert(v);
+    }
+
+    FlatHashMap(const FlatHashMap& other)
+        : HashHolder(other.hash())
+        , EqHolder(other.eq()) {
+        reserve(other.size());
+        for (const auto& v : other)
+            insertUnique(hashOf(v.first), v);
+    }
+
+    FlatHashMap(FlatHashMap&& other) noexcept
+        : HashHolder(std::move(other.hash()))
+        , EqHolder(std::move(other.eq())) {
+        steal(other);
+    }
+
+    FlatHashMap& operator=(const FlatHashMap& other) {
+        if (this != &other) {
+            FlatHashMap tmp(other);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            hash() = std::move(other.hash());
+            eq() = std::move(other.eq());
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~FlatHashMap() { destroy(); }
+
+    iterator begin() {
+        iterator it(ctrl_, ctrl_ + capacity_, slots_);
+        it.skipEmpty();
+        return it;
+    }
+    iterator end() { return { ctrl_ + capacity_, ctrl_ + capacity_, slots_ + capacity_ }; }
+    const_iterator begin() const { return const_cast<FlatHashMap*>(this)->begin(); }
+    const_iterator end() const { return const_cast<FlatHashMap*>(this)->end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    float load_factor() const { return capacity_ ? static_cast<float>(size_) / capacity_ : 0; }
+
+    void clear() {
+        destroySlots();
+        if (capacity_)
+            std::memset(ctrl_, detail::kEmpty, capacity_);
+        size_ = 0;
+        growth_left_ = maxLoad(capacity_);
+    }
+
+    void reserve(size_t count) {
+        if (count > maxLoad(capacity_))
+            rehash(capacityFor(count));
+    }
+
+    template <typename... Args> std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+        return tryEmplaceImpl(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args> std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        return tryEmplaceImpl(std::move(key), std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return tryEmplaceImpl(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return tryEmplaceImpl(value.first, std::move(value.second));
+    }
+
+    template <typename M> std::pair<iterator, bool> insert_or_assign(const K& key, M&& obj) {
+        auto res = tryEmplaceImpl(key, std::forward<M>(obj));
+        if (!res.second)
+            res.first->second = std::forward<M>(obj);
+        return res;
+    }
+
+    V& operator[](const K& key) { return tryEmplaceImpl(key).first->second; }
+    V& operator[](K&& key) { return tryEmplaceImpl(std::move(key)).first->second; }
+
+    V& at(const K& key) {
+        auto it = find(key);
+        if (it == end())
+            throw std::out_of_range("FlatHashMap::at");
+        return it->second;
+    }
+    const V& at(const K& key) const { return const_cast<FlatHashMap*>(this)->at(key); }
+
+    iterator find(const K& key) {
+        size_t index = findIndex(key, hashOf(key));
+        return index == capacity_ ? end() : iteratorAt(index);
+    }
+    const_iterator find(const K& key) const { return const_cast<FlatHashMap*>(this)->find(key); }
+
+    bool contains(const K& key) const { return findIndex(key, hashOf(key)) != capacity_; }
+    size_t count(const K& key) const { return contains(key); }
+
+    size_t erase(const K& key) {
+        size_t index = findIndex(key, hashOf(key));
+        if (index == capacity_)
+            return 0;
+        eraseAt(index);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos) {
+        size_t index = pos.ctrl_ - ctrl_;
+        eraseAt(index);
+        iterator next = iteratorAt(index);
+        next.skipEmpty();
+        return next;
+    }
+
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+    hasher hash_function() const { return hash(); }
+    key_equal key_eq() const { return eq(); }
+
+private:
+    static constexpr size_t kWidth = Group::kWidth;
+
+    /// Tables are kept at most 7/8 full.
+    static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+    static size_t capacityFor(size_t count) {
+        size_t capacity = kWidth;
+        while (maxLoad(capacity) < count)
+            capacity *= 2;
+        return capacity;
+    }
+
+    Hash& hash() { return HashHolder::function(); }
+    const Hash& hash() const { return HashHolder::function(); }
+    Eq& eq() { return EqHolder::function(); }
+    const Eq& eq() const { return EqHolder::function(); }
+
+    size_t hashOf(const K& key) const { return hash()(key); }
+
+    iterator iteratorAt(size_t index) {
+        return { ctrl_ + index, ctrl_ + capacity_, slots_ + index };
+    }
+
+    /// Visits the start index of the groups of the probe sequence of `hash`. Triangular steps over
+    /// a power-of-two number of groups visit every group exactly once.
+    template <typename F> ALWAYS_INLINE void probe(size_t hash, F&& f) const {
+        size_t mask = capacity_ / kWidth - 1;
+        size_t group = detail::h1(hash) & mask;
+        for (size_t step = 1;; ++step) {
+            if (f(group * kWidth))
+                return;
+            group = (group + step) & mask;
+        }
+    }
+
+    size_t findIndex(const K& key, size_t hash) const {
+        if (__builtin_expect(size_ == 0, 0))
+            return capacity_;
+        size_t result = capacity_;
+        int8_t h2 = detail::h2(hash);
+        probe(hash, [&](size_t offset) {
+            Group g(ctrl_ + offset);
+            for (uint32_t m = g.match(h2); m; m &= m - 1) {
+                size_t index = offset + __builtin_ctz(m);
+                if (eq()(slots_[index].value.first, key)) {
+                    result = index;
+                    return true;
+                }
+            }
+            return g.matchEmpty() != 0;
+        });
+        return result;
+    }
+
+    /// First empty or deleted slot on the probe sequence of `hash`.
+    size_t findFirstNonFull(size_t hash) const {
+        size_t result = 0;
+        probe(hash, [&](size_t offset) {
+            uint32_t m = Group(ctrl_ + offset).matchEmptyOrDeleted();
+            if (m) {
+                result = offset + __builtin_ctz(m);
+                return true;
+            }
+            return false;
+        });
+        return result;
+    }
+
+    template <typename KK, typename... Args>
+    std::pair<iterator, bool> tryEmplaceImpl(KK&& key, Args&&... args) {
+        size_t hash = hashOf(key);
+        size_t index = findIndex(key, hash);
+        if (index != capacity_)
+            return { iteratorAt(index), false };
+
+        index = prepareInsert(hash);
+        new (&slots_[index].mutable_value) std::pair<K, V>(std::piecewise_construct,
+            std::forward_as_tuple(std::forward<KK>(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        return { iteratorAt(index), true };
+    }
+
+    /// Claims a slot for a key known to be absent and marks it full.
+    size_t prepareInsert(size_t hash) {
+        size_t index = capacity_ ? findFirstNonFull(hash) : 0;
+        bool full = !capacity_ || (growth_left_ == 0 && ctrl_[index] != detail::kDeleted);
+        if (__builtin_expect(full, 0)) {
+            growOrCompact();
+            index = findFirstNonFull(hash);
+        }
+        if (ctrl_[index] == detail::kEmpty)
+            --growth_left_;
+        ctrl_[index] = detail::h2(hash);
+        ++size_;
+        return index;
+    }
+
+    template <typename T> void insertUnique(size_t hash, T&& value) {
+        size_t index = prepareInsert(hash);
+        new (&slots_[index].mutable_value) std::pair<K, V>(std::forward<T>(value));
+    }
+
+    void eraseAt(size_t index) {
+        slots_[index].mutable_value.~pair();
+        --size_;
+        size_t offset = index & ~(kWidth - 1);
+        if (Group(ctrl_ + offset).matchEmpty()) {
+            ctrl_[index] = detail::kEmpty;
+            ++growth_left_;
+        } else {
+            ctrl_[index] = detail::kDeleted;
+        }
+    }
+
+    /// Out of room: either the table is really full, or tombstones ate the growth budget. In the
+    /// latter case rehashing in place at the same capacity is enough.
+    void growOrCompact() {
+        if (capacity_ && size_ <= maxLoad(capacity_) / 2)
+            rehash(capacity_);
+        else
+            rehash(capacity_ ? capacity_ * 2 : kWidth);
+    }
+
+    void rehash(size_t new_capacity) {
+        int8_t* old_ctrl = ctrl_;
+        Slot* old_slots = slots_;
+        size_t old_capacity = capacity_;
+
+        allocate(new_capacity);
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_ctrl[i] >= 0) {
+                auto& v = old_slots[i].mutable_value;
+                insertUnique(hashOf(v.first), std::move(v));
+                v.~pair();
+            }
+        }
+        deallocate(old_ctrl, old_slots, old_capacity);
+    }
+
+    void allocate(size_t capacity) {
+        static_assert(alignof(Slot) <= 16 || alignof(Slot) % 16 == 0);
+        constexpr size_t align = alignof(Slot) < 16 ? 16 : alignof(Slot);
+        size_t ctrl_bytes = (capacity + align - 1) / align * align;
+        char* mem = static_cast<char*>(::operator new(
+            ctrl_bytes + capacity * sizeof(Slot), std::align_val_t(align)));
+        ctrl_ = reinterpret_cast<int8_t*>(mem);
+        slots_ = reinterpret_cast<Slot*>(mem + ctrl_bytes);
+        std::memset(ctrl_, detail::kEmpty, capacity);
+        capacity_ = capacity;
+        size_ = 0;
+        growth_left_ = maxLoad(capacity);
+    }
+
+    static void deallocate(int8_t* ctrl, Slot*, size_t capacity) {
+        if (!capacity)
+            return;
+        constexpr size_t align = alignof(Slot) < 16 ? 16 : alignof(Slot);
+        ::operator delete(ctrl, std::align_val_t(align));
+    }
+
+    void destroySlots() {
+        if constexpr (!std::is_trivially_destructible_v<std::pair<K, V>>) {
+            for (size_t i = 0; i < capacity_; ++i)
+                if (ctrl_[i] >= 0)
+                    slots_[i].mutable_value.~pair();
+        }
+    }
+
+    void destroy() {
+        destroySlots();
+        deallocate(ctrl_, slots_, capacity_);
+        ctrl_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = size_ = growth_left_ = 0;
+    }
+
+    void steal(FlatHashMap& other) {
+        ctrl_ = std::exchange(other.ctrl_, nullptr);
+        slots_ = std::exchange(other.slots_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+        size_ = std::exchange(other.size_, 0);
+        growth_left_ = std::exchange(other.growth_left_, 0);
+    }
+
+    int8_t* ctrl_ = nullptr;
+    Slot* slots_ = nullptr;
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    /// Number of empty slots that may still be filled before the table has to grow.
+    size_t growth_left_ = 0;
+};
+
+} // namespace ccutils
@@ -0,0 +1,642 @@
+#pragma once
+
+/** Asynchronous logging on top of \c print.hpp.
+ *
+ * A LOG_* statement copies its arguments, the address of its call site (format string and level)
+ * and a timestamp into a ring buffer owned by the calling thread, and returns. A background thread
+ * drains the rings, formats each record with \c Printf and writes what it drained from all threads
+ * with a single writev. The calling thread never formats, locks or makes a system call, unless its
+ * ring is full and it has to wait for the background thread to catch up.
+ *
+ * Arguments are copied by value: numbers and pointers as they are, C strings, std::string and
+ * std::string_view as their characters, so that they can be printed with %s, and anything else
+ * with its copy constructor, to be converted with to_string for %$ in the background thread.
+ * %n isn't supported, and code run by the background thread, such as to_string, must not log.
+ * Lines from one thread come out in order, lines from different threads are interleaved in
+ * batches.
+ *
+ * \example
+ * \code
+ * LOG_INFO("served %s in %.3f ms", request.path, elapsed);
+ * \endcode
+ */
+
+#include "BinaryLog.hpp"
+#include "print.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace ccutils {
+
+enum class LogFormat { Text, Binary };
+
+/// Size of each thread's ring. Records larger than a quarter of it are written synchronously.
+static constexpr size_t LOG_RING_SIZE = 1 << 20;
+/// How long the background thread sleeps when there is nothing to write.
+static constexpr std::chrono::milliseconds LOG_POLL_INTERVAL(1);
+
+namespace detail {
+
+    using LogContext = print_detail::container_writer<std::string>;
+
+    /// What is done with the arguments of a record, for their types: formatting them, or
+    /// appending them to a binary log, see \c BinaryLog.hpp.
+    struct LogCodec {
+        void (*format)(LogContext& ctx, const char* format, const char* args);
+        void (*encode)(std::string& out, const char* format, const char* args);
+    };
+
+    /// The start of everything in a ring: a record, or padding up to the end of the ring.
+    struct LogSpan {
+        uint32_t size;
+        uint32_t padding;
+    };
+
+    /// A record, followed by its arguments.
+    struct LogRecord {
+        LogSpan span;
+        const LogSite* site;
+        const LogCodec* codec;
+        uint64_t ticks;
+    };
+
+    static constexpr size_t LOG_ALIGN = alignof(LogRecord);
+
+    constexpr size_t logAlign(size_t n) { return (n + LOG_ALIGN - 1) & ~(LOG_ALIGN - 1); }
+
+    /** How an argument of type T is copied into a record and read back: `size` is an upper bound
+     *  of the bytes `store` writes, `load` returns what is given to \c Printf and `destroy` runs
+     *  once it is done. This is the general case, a copy constructed in the record.
+     **/
+    template <class T, class = void> struct LogArg {
+        static_assert(alignof(T) <= LOG_ALIGN, "log arguments can't be aligned to more than 8 bytes");
+
+        static size_t size(const T&) { return sizeof(T) + alignof(T) - 1; }
+
+        static char* store(char* p, const T& v) {
+            p = reinterpret_cast<char*>(
+                (reinterpret_cast<uintptr_t>(p) + alignof(T) - 1) & ~(alignof(T) - 1));
+            new (p) T(v);
+            return p + sizeof(T);
+        }
+
+        static const T& load(const char*& p) {
+            p = reinterpret_cast<const char*>(
+                (reinterpret_cast<uintptr_t>(p) + alignof(T) - 1) & ~(alignof(T) - 1));
+            const T* v = std::launder(reinterpret_cast<const T*>(p));
+            p += sizeof(T);
+            return *v;
+        }
+
+        static void destroy(const T& v) { v.~T(); }
+    };
+
+    /// Numbers, enums and pointers other than strings, copied byte for byte.
+    template <class T>
+    struct LogArg<T,
+        std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_null_pointer_v<T>
+            || (std::is_pointer_v<T>
+                && !std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, char>)>> {
+        static constexpr size_t size(const T&) { return sizeof(T); }
+
+        static char* store(char* p, const T& v) {
+            std::memcpy(p, &v, sizeof(T));
+            return p + sizeof(T);
+        }
+
+        /// Enums are read back as their underlying type, which Printf takes for %d.
+        static auto load(const char*& p) {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            if constexpr (std::is_enum_v<T>)
+                return static_cast<std::underlying_type_t<T>>(v);
+            else
+                return v;
+        }
+
+        template <class U> static void destroy(const U&) {}
+    };
+
+    /// Strings, copied as a length and the characters with a terminator, and read back as a C
+    /// string. A null char* is read back as a null pointer.
+    struct LogString {
+        static constexpr uint32_t NULL_STRING = UINT32_MAX;
+
+        static size_t size(std::string_view s) { return sizeof(uint32_t) + s.size() + 1; }
+
+        static char* store(char* p, const char* s, uint32_t length) {
+            std::memcpy(p, &length, sizeof(length));
+            p += sizeof(length);
+            if (length == NULL_STRING)
+                return p;
+            std::memcpy(p, s, length);
+            p[length] = '\0';
+            return p + length + 1;
+        }
+
+        static const char* load(const char*& p) {
+            uint32_t length;
+            std::memcpy(&length, p, sizeof(length));
+            p += sizeof(length);
+            if (length == NULL_STRING)
+                return nullptr;
+            const char* s = p;
+            p += length + 1;
+            return s;
+        }
+
+        static void destroy(const char*) {}
+    };
+
+    template <> struct LogArg<const char*> : LogString {
+        static size_t size(const char* s) { return s ? LogString::size(s) : sizeof(uint32_t); }
+
+        static char* store(char* p, const char* s) {
+            return LogString::store(p, s, s ? uint32_t(std::strlen(s)) : NULL_STRING);
+        }
+    };
+
+    template <> struct LogArg<char*> : LogArg<const char*> {};
+
+    template <> struct LogArg<std::string_view> : LogString {
+        static char* store(char* p, std::string_view s) {
+            return LogString::store(p, s.data(), uint32_t(s.size()));
+        }
+    };
+
+    template <> struct LogArg<std::string> : LogArg<std::string_view> {};
+
+    /// Calls `f` with the arguments of a record, as \c LogArg reads them back, then destroys them.
+    template <class... Ts, class F, size_t... I>
+    void visitLog(const char* args, F&& f, std::index_sequence<I...>) {
+        // braced initializers are evaluated left to right, in the order the arguments were stored
+        const std::tuple<decltype(LogArg<Ts>::load(args))...> values { LogArg<Ts>::load(args)... };
+        try {
+            f(std::get<I>(values)...);
+        } catch (...) {
+            (LogArg<Ts>::destroy(std::get<I>(values)), ...);
+            throw;
+        }
+        (LogArg<Ts>::destroy(std::get<I>(values)), ...);
+    }
+
+    template <class... Ts> void formatLog(LogContext& ctx, const char* format, const char* args) {
+        visitLog<Ts...>(
+            args, [&](const auto&... values) { print_detail::Printf(ctx, format, values...); },
+            std::index_sequence_for<Ts...>());
+    }
+
+    template <class... Ts> void encodeLog(std::string& out, const char* format, const char* args) {
+        std::array<print_detail::format_spec, sizeof...(Ts)> specs {};
+        if constexpr ((isLogObject<std::decay_t<decltype(LogArg<Ts>::load(args))>> || ...))
+            logArgSpecs(format, specs.data(), specs.size());
+        visitLog<Ts...>(
+            args,
+            [&](const auto&... values) {
+                putVarint(out, sizeof...(values));
+                size_t i = 0;
+                (putLogArg(out, values, specs[i++]), ...);
+            },
+            std::index_sequence_for<Ts...>());
+    }
+
+    /// The codec of records stored by \c Logger::log with arguments of types Ts.
+    template <class... Ts> inline constexpr LogCodec LOG_CODEC = { &formatLog<Ts...>, &encodeLog<Ts...> };
+
+    /// A timestamp that is cheap to take, in units that \c LogClock converts to wall time.
+    inline uint64_t logTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    /** Converts \c logTicks to nanoseconds since the epoch, from the tick rate measured between
+     *  the first sample and the latest one, and the offset of the latest one. Samples are taken by
+     *  the background thread, so reading the wall clock, which costs more than reading the TSC,
+     *  stays off the calling threads.
+     **/
+    class LogClock {
+    public:
+        LogClock()
+            : first_(now())
+            , latest_(first_) {}
+
+        void sample() {
+            latest_ = now();
+            if (latest_.ticks > first_.ticks && latest_.time > first_.time)
+                nsPerTick_ = double(latest_.time - first_.time) / double(latest_.ticks - first_.ticks);
+        }
+
+        int64_t time(uint64_t ticks) const {
+            return latest_.time + int64_t(double(int64_t(ticks - latest_.ticks)) * nsPerTick_);
+        }
+
+    private:
+        struct Sample {
+            uint64_t ticks;
+            int64_t time;
+        };
+
+        static Sample now() {
+            return { logTicks(),
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count() };
+        }
+
+        Sample first_;
+        Sample latest_;
+        double nsPerTick_ = 1;
+    };
+
+    /** A ring of records with one producer, the thread that owns it, and one consumer, the logger's
+     *  background thread. Positions only ever grow; a record never wraps around the end of the
+     *  ring, the producer pads up to the end instead.
+     **/
+    class LogRing {
+    public:
+        explicit LogRing(size_t capacity)
+            : buffer_(new (std::align_val_t(64)) char[capacity])
+            , capacity_(capacity) {}
+
+        ~LogRing() { ::operator delete[](buffer_, std::align_val_t(64)); }
+
+        LogRing(const LogRing&) = delete;
+        LogRing& operator=(const LogRing&) = delete;
+
+        size_t capacity() const { return capacity_; }
+
+        /// Room for a record of `size` bytes, waiting for the consumer if the ring is full.
+        char* reserve(size_t size) {
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            const size_t offset = head & (capacity_ - 1);
+            const size_t padding = offset + size > capacity_ ? capacity_ - offset : 0;
+            while (head + padding + size - cachedTail_ > capacity_) {
+                cachedTail_ = tail_.load(std::memory_order_acquire);
+                if (head + padding + size - cachedTail_ > capacity_)
+                    std::this_thread::yield();
+            }
+            if (padding) {
+                new (buffer_ + offset) LogSpan { uint32_t(padding), 1 };
+                head += padding;
+            }
+            reserved_ = head + size;
+            return buffer_ + (head & (capacity_ - 1));
+        }
+
+        /// Publishes the record from the last \c reserve.
+        void commit() { head_.store(reserved_, std::memory_order_release); }
+
+        /// Calls `f(record)` for every published record and returns the position after the last
+        /// one, to be given to \c release once the records aren't needed anymore.
+        template <class F> uint64_t consume(F&& f) const {
+            uint64_t tail = tail_.load(std::memory_order_relaxed);
+            const uint64_t head = head_.load(std::memory_order_acquire);
+            while (tail != head) {
+                const char* p = buffer_ + (tail & (capacity_ - 1));
+                const LogSpan* span = std::launder(reinterpret_cast<const LogSpan*>(p));
+                if (!span->padding)
+                    f(*std::launder(reinterpret_cast<const LogRecord*>(p)));
+                tail += span->size;
+            }
+            return tail;
+        }
+
+        void release(uint64_t tail) { tail_.store(tail, std::memory_order_release); }
+
+        /// Set once the owning thread has exited; the ring is dropped when it's drained.
+        std::atomic<bool> closed { false };
+
+    private:
+        char* const buffer_;
+        const size_t capacity_;
+
+        alignas(64) std::atomic<uint64_t> head_ { 0 };
+        uint64_t cachedTail_ = 0;
+        uint64_t reserved_ = 0;
+
+        alignas(64) std::atomic<uint64_t> tail_ { 0 };
+    };
+
+} // namespace detail
+
+/** The process wide logger behind the LOG_* macros. Writes to stderr unless told otherwise, and
+ *  drops messages below \c LogLevel::Info unless its level is lowered.
+ **/
+class Logger {
+public:
+    static Logger& global() {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /// Writes everything that was logged, then stops the background thread.
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        thread_.join();
+    }
+
+    bool enabled(LogLevel level) const { return int(level) >= level_.load(std::memory_order_relaxed); }
+    void setLevel(LogLevel level) { level_.store(int(level), std::memory_order_relaxed); }
+
+    /** The file descriptor messages go to, from the next ones on, and whether they are written as
+     *  text or in the binary format of \c BinaryLog.hpp. Messages logged before the call are
+     *  flushed to the previous output first. Binary output starts with a header and has the format
+     *  string of each call site the first time it is used. The file descriptor isn't closed by the
+     *  logger.
+     **/
+    void setOutput(int fd, LogFormat format = LogFormat::Text) {
+        flush();
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        fd_ = fd;
+        format_ = format;
+        if (format == LogFormat::Binary) {
+            siteIds_.clear();
+            previousTime_ = 0;
+            write({ std::string(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)) });
+        }
+    }
+
+    /// Copies a message into the calling thread's ring. Use the LOG_* macros instead.
+    template <class... Ts> void log(const LogSite& site, const Ts&... args) {
+        const size_t size = detail::logAlign(
+            sizeof(detail::LogRecord) + (size_t(0) + ... + detail::LogArg<std::decay_t<Ts>>::size(args)));
+        detail::LogRing& ring = threadRing();
+        if (size > ring.capacity() / 4 || size > UINT32_MAX)
+            return logNow(site, size, args...);
+        store(ring.reserve(size), size, site, args...);
+        ring.commit();
+    }
+
+    /// Returns once everything logged before the call, by any thread, has been written.
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // the pass under way may have missed the latest records, the one after can't
+        const uint64_t target = passes_ + 2;
+        flushing_ = true;
+        wake_.notify_one();
+        drained_.wait(lock, [&] { return passes_ >= target; });
+    }
+
+private:
+    /// Owns the calling thread's ring on the thread's side.
+    struct RingHandle {
+        explicit RingHandle(Logger& logger)
+            : ring(std::make_shared<detail::LogRing>(LOG_RING_SIZE)) {
+            std::lock_guard<std::mutex> lock(logger.ringsMutex_);
+            logger.rings_.push_back(ring);
+        }
+        ~RingHandle() { ring->closed.store(true, std::memory_order_release); }
+
+        std::shared_ptr<detail::LogRing> ring;
+    };
+
+    Logger()
+        : thread_([this] { run(); }) {}
+
+    detail::LogRing& threadRing() {
+        thread_local RingHandle handle(*this);
+        return *handle.ring;
+    }
+
+    template <class... Ts>
+    static void store(char* p, size_t size, const LogSite& site, const Ts&... args) {
+        const detail::LogCodec* codec = &detail::LOG_CODEC<std::decay_t<Ts>...>;
+        new (p) detail::LogRecord { { uint32_t(size), 0 }, &site, codec, detail::logTicks() };
+        p += sizeof(detail::LogRecord);
+        ((p = detail::LogArg<std::decay_t<Ts>>::store(p, args)), ...);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            const bool stopping = stop_;
+            flushing_ = false;
+            lock.unlock();
+            const size_t records = drain();
+            lock.lock();
+            ++passes_;
+            drained_.notify_all();
+            if (stopping && records == 0)
+                return;
+            if (records == 0)
+                wake_.wait_for(lock, LOG_POLL_INTERVAL, [this] { return stop_ || flushing_; });
+        }
+    }
+
+    /// Formats and writes everything in the rings. Returns the number of records.
+    size_t drain() {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        clock_.sample();
+        texts_.resize(rings_.size());
+        tails_.resize(rings_.size());
+        closed_.resize(rings_.size());
+
+        size_t records = 0;
+        for (size_t i = 0; i < rings_.size(); ++i) {
+            // a ring closed before consuming it is empty afterwards
+            closed_[i] = rings_[i]->closed.load(std::memory_order_acquire);
+            texts_[i].clear();
+            tails_[i] = rings_[i]->consume([&](const detail::LogRecord& record) {
+                render(texts_[i], record);
+                ++records;
+            });
+        }
+        write(texts_);
+
+        size_t kept = 0;
+        for (size_t i = 0; i < rings_.size(); ++i) {
+            rings_[i]->release(tails_[i]);
+            if (!closed_[i])
+                rings_[kept++] = std::move(rings_[i]);
+        }
+        rings_.resize(kept);
+        return records;
+    }
+
+    /// Appends a record to `out`, as a line of text or a binary record.
+    void render(std::string& out, const detail::LogRecord& record) {
+        const int64_t time = clock_.time(record.ticks);
+        const LogSite& site = *record.site;
+        const char* args = reinterpret_cast<const char*>(&record) + sizeof(detail::LogRecord);
+
+        if (format_ == LogFormat::Text) {
+            detail::LogContext ctx(out);
+            prefix_.format(ctx, time, site.level);
+            const size_t message = out.size();
+            try {
+                record.codec->format(ctx, site.format, args);
+            } catch (const std::exception& e) {
+                // what was formatted before the error is dropped, as binary records can't keep it
+                out.resize(message);
+                print_detail::Printf(ctx, "<%s in \"%s\">", e.what(), site.format);
+            }
+            ctx.write('\n');
+            return;
+        }
+
+        // undone with the bytes if encoding fails, as the site and time of this record are then not
+        // written
+        const size_t start = out.size();
+        const int64_t previousTime = previousTime_;
+        const bool knownSite = siteIds_.count(&site) != 0;
+        try {
+            beginRecord(out, site, time);
+            record.codec->encode(out, site.format, args);
+        } catch (const std::exception& e) {
+            // to_string failed, the error takes the place of the message as in text mode
+            static constexpr LogSite ERROR_SITES[] = {
+                { "<%s in \"%s\">", LogLevel::Debug },
+                { "<%s in \"%s\">", LogLevel::Info },
+                { "<%s in \"%s\">", LogLevel::Warning },
+                { "<%s in \"%s\">", LogLevel::Error },
+            };
+            out.resize(start);
+            previousTime_ = previousTime;
+            if (!knownSite)
+                siteIds_.erase(&site);
+            beginRecord(out, ERROR_SITES[int(site.level) & 3], time);
+            detail::putVarint(out, 2);
+            detail::putLogArg(out, static_cast<const char*>(e.what()));
+            detail::putLogArg(out, site.format);
+        }
+    }
+
+    /// Appends the site of a binary record, the first time it is used, and the record's header.
+    void beginRecord(std::string& out, const LogSite& site, int64_t time) {
+        auto [it, added] = siteIds_.try_emplace(&site, siteIds_.size());
+        if (added) {
+            const size_t length = std::strlen(site.format);
+            out += char(detail::LogEntry::Site);
+            detail::putVarint(out, it->second);
+            out += char(site.level);
+            detail::putVarint(out, length);
+            out.append(site.format, length);
+        }
+        out += char(detail::LogEntry::Record);
+        detail::putVarint(out, it->second);
+        detail::putVarint(out, detail::zigzag(time - previousTime_));
+        previousTime_ = time;
+    }
+
+    /// Writes all of `texts` with as few system calls as possible.
+    void write(const std::vector<std::string>& texts) {
+        std::vector<iovec>& iov = iov_;
+        iov.clear();
+        for (const std::string& text : texts) {
+            if (!text.empty())
+                iov.push_back({ const_cast<char*>(text.data()), text.size() });
+        }
+
+        const int fd = fd_;
+        size_t first = 0;
+        while (first < iov.size()) {
+            const int count = int(std::min<size_t>(iov.size() - first, IOV_MAX));
+            ssize_t n = writev(fd, &iov[first], count);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            // skip what was written, which may end in the middle of a buffer
+            while (first < iov.size() && size_t(n) >= iov[first].iov_len)
+                n -= iov[first++].iov_len;
+            if (first < iov.size()) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + n;
+                iov[first].iov_len -= n;
+            }
+        }
+    }
+
+    /// For records that don't fit in a ring: formats and writes on the calling thread, after
+    /// everything that was logged before.
+    template <class... Ts> void logNow(const LogSite& site, size_t size, const Ts&... args) {
+        flush();
+        std::unique_ptr<char[]> buffer(new char[size]);
+        store(buffer.get(), size, site, args...);
+
+        std::vector<std::string> text(1);
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        clock_.sample();
+        render(text[0], *std::launder(reinterpret_cast<const detail::LogRecord*>(buffer.get())));
+        write(text);
+    }
+
+    std::atomic<int> level_ { int(LogLevel::Info) };
+
+    // the rings, and everything used to drain and write them
+    std::mutex ringsMutex_;
+    std::vector<std::shared_ptr<detail::LogRing>> rings_;
+    std::vector<std::string> texts_;
+    std::vector<uint64_t> tails_;
+    std::vector<char> closed_;
+    std::vector<iovec> iov_;
+    detail::LogClock clock_;
+    detail::LogLinePrefix prefix_;
+    int fd_ = STDERR_FILENO;
+    LogFormat format_ = LogFormat::Text;
+    std::unordered_map<const LogSite*, uint64_t> siteIds_;
+    int64_t previousTime_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    uint64_t passes_ = 0;
+    bool flushing_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+} // namespace ccutils
+
+#define CCUTILS_LOG(level, format, ...)                                                            \
+    do {                                                                                           \
+        static constexpr ::ccutils::LogSite ccutilsLogSite { format, level };                      \
+        if (::ccutils::Logger::global().enabled(level))                                            \
+            ::ccutils::Logger::global().log(ccutilsLogSite, ##__VA_ARGS__);                        \
+    } while (0)
+
+#define LOG_DEBUG(format, ...) CCUTILS_LOG(::ccutils::LogLevel::Debug, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) CCUTILS_LOG(::ccutils::LogLevel::Info, format, ##__VA_ARGS__)
+#define LOG_WARNING(format, ...) CCUTILS_LOG(::ccutils::LogLevel::Warning, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) CCUTILS_LOG(::ccutils::LogLevel::Error, format, ##__VA_ARGS__)
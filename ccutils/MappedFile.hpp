@@ -0,0 +1,76 @@
+#pragma once
+
+#include "scope.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ccutils {
+
+/** A whole file mapped read-only into memory. Throws std::system_error if the file can't be opened or mapped.
+ *  Empty files are not mapped at all and have a null `data()`.
+ **/
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(errno, std::system_category(), path);
+        SCOPE_EXIT { close(fd); };
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            throw std::system_error(errno, std::system_category(), path);
+
+        size_ = st.st_size;
+        if (size_ == 0)
+            return;
+
+        void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(), path);
+        data_ = static_cast<const char*>(addr);
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0)) {}
+
+    MappedFile& operator=(MappedFile other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~MappedFile() {
+        if (data_)
+            munmap(const_cast<char*>(data_), size_);
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return { data_, size_ }; }
+
+    /// Hints that the file will be read front to back, so the kernel reads ahead aggressively.
+    void adviseSequential() const {
+        if (data_)
+            madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace ccutils
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+#include "random.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+namespace ccutils {
+
+/** Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"), a counter-based generator: every
+ *  block of four outputs is a pure function of a 64-bit key and a 128-bit counter, see \c block. As an engine, the
+ *  counter is made of a 64-bit stream id (high half) and the position within the stream (low half), so seeking to
+ *  any position is O(1) and different streams never overlap.
+ *
+ *  \example
+ *  \code
+ *  auto rng = randomSeeded<Philox4x32>();
+ *  rng.seek(1'000'000'000);  // no need to generate the first billion numbers
+ *  \endcode
+ **/
+class Philox4x32 {
+public:
+    using result_type = std::uint32_t;
+    using Key = std::array<std::uint32_t, 2>;
+    using Counter = std::array<std::uint32_t, 4>;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    explicit Philox4x32(std::uint64_t key = 0, std::uint64_t stream = 0)
+        : key_{std::uint32_t(key), std::uint32_t(key >> 32)}
+        , stream_(stream) {}
+
+    template <typename TSeedSeq, typename = detail::EnableIfSeedSeq<TSeedSeq, Philox4x32>>
+    explicit Philox4x32(TSeedSeq& seq) {
+        this->seed(seq);
+    }
+
+    void seed(std::uint64_t key, std::uint64_t stream = 0) { *this = Philox4x32(key, stream); }
+
+    template <typename TSeedSeq, typename = detail::EnableIfSeedSeq<TSeedSeq, Philox4x32>>
+    void seed(TSeedSeq& seq) {
+        std::uint64_t words[2];
+        detail::seedWords(seq, words);
+        seed(words[0], words[1]);
+    }
+
+    /** The generator itself: ten rounds of Philox over `counter` with `key`. **/
+    static Counter block(Key key, Counter counter) {
+        for (int round = 0; round < 10; ++round) {
+            if (round > 0) {
+                key[0] += 0x9e3779b9;
+                key[1] += 0xbb67ae85;
+            }
+            const std::uint64_t p0 = std::uint64_t(0xd2511f53) * counter[0];
+            const std::uint64_t p1 = std::uint64_t(0xcd9e8d57) * counter[2];
+            counter = {std::uint32_t(p1 >> 32) ^ counter[1] ^ key[0], std::uint32_t(p1),
+                       std::uint32_t(p0 >> 32) ^ counter[3] ^ key[1], std::uint32_t(p0)};
+        }
+        return counter;
+    }
+
+    /** Output number `pos` of `stream` under `key`, without any engine state. **/
+    static result_type at(std::uint64_t key, std::uint64_t stream, std::uint64_t pos) {
+        return Philox4x32(key, stream).blockAt(pos / 4)[pos % 4];
+    }
+
+    result_type operator()() {
+        if (index_ == 0)
+            buffer_ = blockAt(position_ / 4);
+        const result_type result = buffer_[index_];
+        index_ = (index_ + 1) % 4;
+        ++position_;
+        return result;
+    }
+
+    /** Moves to output number `pos` of the current stream. **/
+    void seek(std::uint64_t pos) {
+        position_ = pos;
+        index_ = pos % 4;
+        if (index_)
+            buffer_ = blockAt(pos / 4);
+    }
+
+    std::uint64_t position() const { return position_; }
+    std::uint64_t stream() const { return stream_; }
+
+    void discard(unsigned long long n) { seek(position_ + n); }
+
+    /** Switches to the next stream, which never overlaps with the current one. **/
+    void jump() {
+        ++stream_;
+        seek(0);
+    }
+
+    friend bool operator==(const Philox4x32& a, const Philox4x32& b) {
+        return a.key_ == b.key_ && a.stream_ == b.stream_ && a.position_ == b.position_;
+    }
+    friend bool operator!=(const Philox4x32& a, const Philox4x32& b) { return !(a == b); }
+
+private:
+    Counter blockAt(std::uint64_t index) const {
+        return block(key_, {std::uint32_t(index), std::uint32_t(index >> 32), std::uint32_t(stream_),
+                            std::uint32_t(stream_ >> 32)});
+    }
+
+    Key key_;
+    std::uint64_t stream_ = 0;
+    std::uint64_t position_ = 0;
+    Counter buffer_ = {};
+    unsigned index_ = 0;
+};
+
+/** Fills `[first, last)` exactly like `std::generate(first, last, std::ref(rng))`, but splits the range into chunks
+ *  that are generated in parallel, each from a copy of `rng` moved forward with \c discard. The result does not
+ *  depend on the number of threads. `rng` is left positioned after the last generated number.
+ *
+ *  Meant for engines with a cheap \c discard: \c Philox4x32, \c Pcg64 and \c WyRand.
+ **/
+template <typename TEngine>
+void parallelGenerate(typename TEngine::result_type* first, typename TEngine::result_type* last, TEngine& rng,
+                      ThreadPool& pool = ThreadPool::global()) {
+    constexpr std::size_t chunk = 1 << 16;
+    const std::size_t size = last - first;
+    pool.parallelFor(0, (size + chunk - 1) / chunk, [&](std::size_t i) {
+        TEngine local = rng;
+        local.discard(i * chunk);
+        std::generate(first + i * chunk, first + std::min(size, (i + 1) * chunk), std::ref(local));
+    });
+    rng.discard(size);
+}
+
+}  // namespace ccutils
@@ -50,7 +50,7 @@ private:
     /// The current 8 bytes of input data.
     union {
         uint64_t current_word;
-        UInt8 current_bytes[8];
+        uint8_t current_bytes[8];
     };
 
     void finalize() {
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "Columns.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ccutils {
+
+/** Writes rows of text cells to a stream as a table, one row at a time, for more rows than can be
+ *  held, such as the results of a query. The first rows, up to \c sampleRows, are kept to choose
+ *  the width of each column: the widest line of its cells, cut down evenly from the widest columns
+ *  when the table would be wider than \c maxWidth. The rows after those are written as they come,
+ *  so memory does not grow with the number of rows. Cells wrap with the rules of \c Column, or are
+ *  cut to their first line, ending in "...", in the columns set to \c truncate.
+ *
+ *  \code
+ *  TableWriter table(std::cout);
+ *  table.header({ "id", "user", "message" }).maxWidth(100).truncate(2);
+ *  for (auto const& result : results)
+ *      table.row({ result.id, result.user, result.message });
+ *  \endcode
+ **/
+class TableWriter {
+    std::ostream& m_os;
+    std::vector<std::string> m_header;
+    size_t m_sampleRows = 1000;
+    size_t m_maxWidth = 0;
+    std::string m_separator = "  ";
+    std::vector<size_t> m_fixedWidths;
+    std::vector<bool> m_truncate;
+
+    // the rows kept until the widths are chosen: their cells one after the other, where each cell
+    // ends, and how many cells each row has
+    std::string m_sample;
+    std::vector<size_t> m_cellEnds;
+    std::vector<size_t> m_rowCells;
+
+    std::vector<size_t> m_widths;
+    std::vector<std::vector<ColumnLine>> m_lines;
+    std::vector<bool> m_cut;
+    std::vector<std::string_view> m_cells;
+    std::string m_buffer;
+
+public:
+    /// Output is written to the stream in pieces of about this many bytes.
+    static constexpr size_t WRITE_BYTES = 1 << 16;
+
+    explicit TableWriter(std::ostream& os)
+        : m_os(os) {}
+    TableWriter(TableWriter const&) = delete;
+    auto operator=(TableWriter const&) -> TableWriter& = delete;
+    ~TableWriter() { flush(); }
+
+    /// Column names, written first and followed by a rule. They count towards the widths.
+    auto header(std::initializer_list<std::string_view> names) -> TableWriter& {
+        assert(sampling());
+        m_header.assign(names.begin(), names.end());
+        return *this;
+    }
+    /// How many rows are kept to choose the widths from.
+    auto sampleRows(size_t rows) -> TableWriter& {
+        assert(sampling());
+        m_sampleRows = rows;
+        return *this;
+    }
+    /// The width of the whole table in terminal columns, or 0 for no limit.
+    auto maxWidth(size_t width) -> TableWriter& {
+        assert(sampling());
+        m_maxWidth = width;
+        return *this;
+    }
+    /// What goes between columns, two spaces by default.
+    auto separator(std::string_view separator) -> TableWriter& {
+        assert(sampling());
+        m_separator = separator;
+        return *this;
+    }
+    /// Gives `column` a width of its own rather than one chosen from the sample.
+    auto width(size_t column, size_t width) -> TableWriter& {
+        assert(sampling());
+        assert(width > 0);
+        if (m_fixedWidths.size() <= column)
+            m_fixedWidths.resize(column + 1, 0);
+        m_fixedWidths[column] = width;
+        return *this;
+    }
+    /// Cuts the cells of `column` to one line instead of wrapping them.
+    auto truncate(size_t column) -> TableWriter& {
+        assert(sampling());
+        if (m_truncate.size() <= column)
+            m_truncate.resize(column + 1, false);
+        m_truncate[column] = true;
+        return *this;
+    }
+
+    void row(std::initializer_list<std::string_view> cells) { row(cells.begin(), cells.end()); }
+
+    /** Adds a row of cells, anything a std::string_view can be made of. Missing cells at the end
+     *  are blank. Once the widths are chosen a row can't have more cells than the table has
+     *  columns, and std::invalid_argument is thrown.
+     **/
+    template <class It> void row(It first, It last) {
+        if (sampling()) {
+            size_t cells = 0;
+            for (; first != last; ++first, ++cells) {
+                m_sample.append(std::string_view(*first));
+                m_cellEnds.push_back(m_sample.size());
+            }
+            m_rowCells.push_back(cells);
+            if (m_rowCells.size() >= m_sampleRows)
+                chooseWidths();
+            return;
+        }
+        m_cells.clear();
+        for (; first != last; ++first)
+            m_cells.emplace_back(*first);
+        if (m_cells.size() > m_widths.size())
+            throw std::invalid_argument("TableWriter: more cells than the table has columns");
+        writeRow(m_cells.data(), m_cells.size());
+        if (m_buffer.size() >= WRITE_BYTES)
+            writeBuffer();
+    }
+
+    /// Writes out everything so far, choosing the widths from the rows so far if they aren't yet.
+    void flush() {
+        if (sampling() && (!m_header.empty() || !m_rowCells.empty()))
+            chooseWidths();
+        writeBuffer();
+    }
+
+    /// The width of each column, once chosen.
+    auto widths() const -> std::vector<size_t> const& { return m_widths; }
+
+private:
+    auto sampling() const -> bool { return m_widths.empty(); }
+
+    /// Chooses the widths from the sample, then writes the header and the sample.
+    void chooseWidths() {
+        size_t columns = std::max({ m_header.size(), m_fixedWidths.size(), m_truncate.size() });
+        for (size_t cells : m_rowCells)
+            columns = std::max(columns, cells);
+        if (columns == 0)
+            columns = 1;
+
+        std::vector<size_t> natural(columns, 0);
+        auto measure = [&](size_t column, std::string_view cell) {
+            size_t pos = 0;
+            while (pos <= cell.size()) {
+                const size_t newline = Column::paragraphEnd(cell, pos);
+                natural[column]
+                    = std::max(natural[column], displayWidth(cell.substr(pos, newline - pos)));
+                pos = newline + 1;
+            }
+        };
+        for (size_t i = 0; i < m_header.size(); ++i)
+            measure(i, m_header[i]);
+        forEachSampleRow([&](std::string_view const* cells, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                measure(i, cells[i]);
+        });
+
+        m_fixedWidths.resize(columns, 0);
+        m_truncate.resize(columns, false);
+        m_widths.assign(columns, 0);
+        size_t fixed = m_separator.empty() ? 0 : displayWidth(m_separator) * (columns - 1);
+        size_t widest = 1;
+        for (size_t i = 0; i < columns; ++i) {
+            if (m_fixedWidths[i])
+                fixed += m_fixedWidths[i];
+            else
+                widest = std::max(widest, natural[i]);
+        }
+        // the widest cap on the sampled columns that fits, found by bisection
+        size_t cap = widest;
+        if (m_maxWidth) {
+            auto total = [&](size_t limit) {
+                size_t sum = fixed;
+                for (size_t i = 0; i < columns; ++i) {
+                    if (!m_fixedWidths[i])
+                        sum += std::max<size_t>(1, std::min(natural[i], limit));
+                }
+                return sum;
+            };
+            size_t low = 1;
+            while (low < cap) {
+                const size_t mid = low + (cap - low + 1) / 2;
+                if (total(mid) <= m_maxWidth)
+                    low = mid;
+                else
+                    cap = mid - 1;
+            }
+        }
+        for (size_t i = 0; i < columns; ++i) {
+            m_widths[i] = m_fixedWidths[i] ? m_fixedWidths[i]
+                                           : std::max<size_t>(1, std::min(natural[i], cap));
+        }
+        m_lines.resize(columns);
+        m_cut.resize(columns);
+
+        if (!m_header.empty()) {
+            m_cells.assign(m_header.begin(), m_header.end());
+            writeRow(m_cells.data(), m_cells.size());
+            const size_t start = m_buffer.size();
+            for (size_t i = 0; i < columns; ++i) {
+                if (i != 0)
+                    m_buffer += m_separator;
+                m_buffer.append(m_widths[i], '-');
+            }
+            endLine(start);
+        }
+        forEachSampleRow([&](std::string_view const* cells, size_t count) {
+            writeRow(cells, count);
+        });
+
+        std::string().swap(m_sample);
+        std::vector<size_t>().swap(m_cellEnds);
+        std::vector<size_t>().swap(m_rowCells);
+        std::vector<std::string>().swap(m_header);
+    }
+
+    template <class F> void forEachSampleRow(F&& f) {
+        size_t cell = 0;
+        for (size_t count : m_rowCells) {
+            m_cells.clear();
+            for (size_t i = 0; i < count; ++i, ++cell) {
+                const size_t start = cell == 0 ? 0 : m_cellEnds[cell - 1];
+                m_cells.emplace_back(m_sample.data() + start, m_cellEnds[cell] - start);
+            }
+            f(m_cells.data(), count);
+        }
+    }
+
+    /// Lays out `cell` in `column` as \c Column::layout does, or only its first line if truncated.
+    void layout(size_t column, std::string_view cell) {
+        auto& lines = m_lines[column];
+        const size_t width = m_widths[column];
+        lines.clear();
+        m_cut[column] = false;
+        size_t pos = 0;
+        size_t newline = Column::paragraphEnd(cell, 0);
+        while (pos < cell.size()) {
+            if (newline < pos)
+                newline = Column::paragraphEnd(cell, pos);
+            lines.push_back(Column::breakLine(cell, pos, newline, width));
+            pos = Column::nextLine(cell, lines.back());
+            if (m_truncate[column]) {
+                if (pos < cell.size() && width > 3) {
+                    lines.back() = Column::breakLine(cell, 0, newline, width - 3);
+                    m_cut[column] = true;
+                }
+                break;
+            }
+        }
+    }
+
+    /// Appends the lines of a row to the buffer, each column padded to its width.
+    void writeRow(std::string_view const* cells, size_t count) {
+        size_t rows = 0;
+        for (size_t i = 0; i < m_widths.size(); ++i) {
+            layout(i, i < count ? cells[i] : std::string_view());
+            rows = std::max(rows, m_lines[i].size());
+        }
+        for (size_t row = 0; row < rows; ++row) {
+            const size_t start = m_buffer.size();
+            for (size_t i = 0; i < m_widths.size(); ++i) {
+                if (i != 0)
+                    m_buffer += m_separator;
+                size_t width = 0;
+                if (row < m_lines[i].size()) {
+                    ColumnLine const& line = m_lines[i][row];
+                    m_buffer.append(cells[i].data() + line.offset, line.length);
+                    if (line.suffix)
+                        m_buffer += '-';
+                    width = line.width();
+                    if (m_cut[i]) {
+                        m_buffer += "...";
+                        width += 3;
+                    }
+                }
+                if (width < m_widths[i])
+                    m_buffer.append(m_widths[i] - width, ' ');
+            }
+            endLine(start);
+        }
+    }
+
+    /// Ends the line that starts at `start` of the buffer, without the spaces it ends with.
+    void endLine(size_t start) {
+        size_t end = m_buffer.size();
+        while (end > start && m_buffer[end - 1] == ' ')
+            --end;
+        m_buffer.resize(end);
+        m_buffer += '\n';
+    }
+
+    void writeBuffer() {
+        m_os.write(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+};
+
+} // namespace ccutils
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ccutils {
+
+/** A fixed set of worker threads pulling jobs from a shared queue.
+ *
+ *  \example
+ *  \code
+ *  ThreadPool::global().parallelFor(0, chunks, [&](size_t i) { process(i); });
+ *  \endcode
+ **/
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            workers_.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_)
+            t.join();
+    }
+
+    /// Shared pool with one thread per core.
+    static ThreadPool& global() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const { return workers_.size(); }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        cv_.notify_one();
+    }
+
+    /** Calls `f(i)` for every i in `[first, last)` and returns once all calls are done. Indices are
+     *  handed out dynamically, so the order and the thread of each call are unspecified. The
+     *  calling thread takes part as well and never waits for a worker to become free, so nested
+     *  calls are fine. The first exception thrown by `f` is rethrown here; indices claimed after
+     *  that are skipped.
+     **/
+    template <typename F> void parallelFor(size_t first, size_t last, F&& f) {
+        if (first >= last)
+            return;
+
+        /// Shared with the helper jobs, which may be dequeued only after this call returned.
+        struct State {
+            std::atomic<size_t> next;
+            std::atomic<size_t> pending;
+            std::atomic<bool> failed{ false };
+            std::mutex mutex;
+            std::condition_variable done;
+            std::exception_ptr error;
+        };
+        auto state = std::make_shared<State>();
+        state->next = first;
+        state->pending = last - first;
+
+        auto run = [state, fp = &f, last] {
+            size_t i;
+            while ((i = state->next.fetch_add(1, std::memory_order_relaxed)) < last) {
+                if (!state->failed.load(std::memory_order_relaxed)) {
+                    try {
+                        (*fp)(i);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        if (!state->error)
+                            state->error = std::current_exception();
+                        state->failed = true;
+                    }
+                }
+                if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->done.notify_all();
+                }
+            }
+        };
+
+        size_t helpers = std::min(size(), last - first - 1);
+        for (size_t h = 0; h < helpers; ++h)
+            submit(run);
+
+        run();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&state] { return state->pending == 0; });
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+
+private:
+    void work() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+                if (stop_ && jobs_.empty())
+                    return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
+
+} // namespace ccutils
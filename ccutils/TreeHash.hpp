@@ -0,0 +1,73 @@
+#pragma once
+
+/** Parallel hashing of large buffers and files.
+ *
+ * The input is cut into chunks of a fixed size. Every chunk is hashed with SipHash 2-4 keyed with
+ * its index, and the root is the SipHash of the total size, the chunk size and the chunk digests
+ * in order. Chunks are hashed on a thread pool, but the result only depends on the data and the
+ * chunk size, never on the number of threads.
+ *
+ * This is a different function than sipHash128 of the whole input: digests computed with
+ * different chunk sizes are not comparable either.
+ */
+
+#include "MappedFile.hpp"
+#include "SipHash.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ccutils {
+
+static constexpr size_t TREE_HASH_CHUNK_SIZE = 4 << 20;
+
+inline void treeHash128(const char* data, size_t size, char* out,
+    size_t chunk_size = TREE_HASH_CHUNK_SIZE, ThreadPool& pool = ThreadPool::global()) {
+    if (chunk_size == 0)
+        throw std::invalid_argument("treeHash128: chunk_size must be positive");
+
+    size_t chunks = (size + chunk_size - 1) / chunk_size;
+    std::vector<uint64_t> digests(2 * chunks);
+
+    pool.parallelFor(0, chunks, [&](size_t i) {
+        size_t offset = i * chunk_size;
+        SipHash hash(i, chunk_size);
+        hash.update(data + offset, std::min(chunk_size, size - offset));
+        hash.get128(digests[2 * i], digests[2 * i + 1]);
+    });
+
+    SipHash root;
+    root.update(uint64_t(size));
+    root.update(uint64_t(chunk_size));
+    root.update(reinterpret_cast<const char*>(digests.data()), digests.size() * sizeof(uint64_t));
+    root.get128(out);
+}
+
+inline uint64_t treeHash64(const char* data, size_t size, size_t chunk_size = TREE_HASH_CHUNK_SIZE,
+    ThreadPool& pool = ThreadPool::global()) {
+    uint64_t out[2];
+    treeHash128(data, size, reinterpret_cast<char*>(out), chunk_size, pool);
+    return out[0] ^ out[1];
+}
+
+/** Tree hash of the contents of the file at `path`. The file is mapped into memory and read
+ *  sequentially by each worker, so it never has to fit in the page cache all at once.
+ **/
+inline void treeHashFile128(const std::string& path, char* out,
+    size_t chunk_size = TREE_HASH_CHUNK_SIZE, ThreadPool& pool = ThreadPool::global()) {
+    MappedFile file(path);
+    file.adviseSequential();
+    treeHash128(file.data(), file.size(), out, chunk_size, pool);
+}
+
+inline uint64_t treeHashFile64(const std::string& path, size_t chunk_size = TREE_HASH_CHUNK_SIZE,
+    ThreadPool& pool = ThreadPool::global()) {
+    uint64_t out[2];
+    treeHashFile128(path, reinterpret_cast<char*>(out), chunk_size, pool);
+    return out[0] ^ out[1];
+}
+
+} // namespace ccutils
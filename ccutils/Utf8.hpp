@@ -0,0 +1,395 @@
+#pragma once
+
+#include "cpuFeatures.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace ccutils {
+
+/// Whether `c` is a UTF-8 continuation byte, 10xxxxxx, which never starts a code point.
+inline bool isUtf8Continuation(char c) { return (static_cast<unsigned char>(c) & 0xc0) == 0x80; }
+
+/** Decodes the code point at `p`, of the `n > 0` bytes there, into `cp`, and returns the length of its encoding.
+ *  Overlong encodings, surrogates, code points past U+10FFFF and truncated sequences are invalid: an invalid sequence
+ *  decodes as U+FFFD of length 1, so that decoding can always carry on with the next byte.
+ **/
+inline size_t decodeUtf8(const char* p, size_t n, char32_t& cp) {
+    const auto lead = static_cast<unsigned char>(p[0]);
+    if (lead < 0x80) {
+        cp = lead;
+        return 1;
+    }
+    cp = 0xfffd;
+    if (lead < 0xc2 || lead > 0xf4)
+        return 1;
+    const size_t length = lead < 0xe0 ? 2 : lead < 0xf0 ? 3 : 4;
+    if (n < length)
+        return 1;
+    char32_t value = lead & (0x7f >> length);
+    for (size_t i = 1; i < length; ++i) {
+        if (!isUtf8Continuation(p[i]))
+            return 1;
+        value = value << 6 | (static_cast<unsigned char>(p[i]) & 0x3f);
+    }
+    if (length == 3 && (value < 0x800 || (value >= 0xd800 && value <= 0xdfff)))
+        return 1;
+    if (length == 4 && (value < 0x10000 || value > 0x10ffff))
+        return 1;
+    cp = value;
+    return length;
+}
+
+namespace detail {
+
+    /** The columns of the code points below U+40000, two bits each, in two stages: `WIDTH_INDEX[cp >> 7]` is the
+     *  block of 128 code points `cp` is in, and `WIDTH_BLOCKS` holds the distinct blocks, 149 of them, for 6.8 KB.
+     *  Generated from the Unicode 14 character database: 0 for combining marks (Mn, Me), format characters (Cf) but
+     *  U+00AD and the prepended concatenation marks, and Hangul medial vowels and final consonants; 2 for East Asian
+     *  Wide and Fullwidth, and for the unassigned code points of the CJK ideograph blocks, which default to Wide; 1
+     *  for the rest.
+     **/
+    inline constexpr uint8_t WIDTH_INDEX[0x40000 >> 7] = {
+        0, 0, 0, 0, 0, 0, 1, 0, 0, 2, 0, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+        24, 25, 26, 27, 0, 0, 28, 0, 0, 0, 0, 0, 0, 0, 29, 30, 31, 32, 33, 0, 34, 35, 36, 37, 38, 39, 0, 40, 0, 0, 0,
+        0, 41, 42, 0, 0, 0, 0, 43, 44, 0, 0, 0, 45, 46, 47, 48, 49, 0, 0, 0, 0, 0, 0, 50, 0, 0, 51, 52, 53, 0, 54, 55,
+        56, 57, 58, 59, 60, 61, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 62, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 63, 0, 0, 64, 65, 0, 0, 66, 67, 68, 69, 70, 71, 0, 72, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 73,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 55, 55, 55, 55, 74, 0,
+        0, 0, 0, 0, 75, 52, 76, 77, 0, 0, 0, 78, 0, 79, 80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 81, 82, 0, 0, 0, 0,
+        83, 0, 0, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 0, 94, 95, 0, 96, 97, 98, 99, 0, 100, 0, 101, 102, 103, 104,
+        0, 0, 105, 106, 107, 108, 0, 109, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 110, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 111, 112, 0, 0, 0, 0, 0, 0, 0, 113, 114, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 115, 55, 55, 55, 55, 55, 55, 55, 55, 55, 116, 117, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 118, 55, 55, 119, 55, 55,
+        120, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 121, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 122, 0, 0, 0, 123, 124, 125, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 126, 127, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 128, 0, 112, 0, 0, 129, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 130, 131, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 132, 133, 0, 134, 135, 0, 136, 137, 138, 139, 140,
+        141, 142, 143, 0, 144, 0, 0, 145, 55, 146, 147, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        148, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+        55, 55, 55, 55, 55, 55, 55, 55, 55, 148
+    };
+
+    inline constexpr uint64_t WIDTH_BLOCKS[][4] = {
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x5555555500000000 },
+        { 0x5555555555500015, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x0000000155555555, 0x1000000000000000, 0x5555555555551041, 0x5555555555555555 },
+        { 0x5440000055555555, 0x5555555555555555, 0x0000000000155555, 0x5555555455555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x1400055555555555, 0x5555555550041400 },
+        { 0x5555555155555555, 0x0000000055555555, 0x5555555555400000, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555400000555, 0x5555555555555555, 0x5155550000155555 },
+        { 0x0010055555555555, 0x5555555550010100, 0x5501555555555555, 0x5555555555555555 },
+        { 0x0000555555555555, 0x5555555555555555, 0x0000000000055555, 0x0000000000000010 },
+        { 0x5555555555555540, 0x5445555555555555, 0x5555000151540001, 0x5555555555555505 },
+        { 0x5555555555555551, 0x5455555555555555, 0x5555555551555401, 0x4555555555555505 },
+        { 0x5555555555555541, 0x5455555555555555, 0x5555555150141541, 0x5555515055555555 },
+        { 0x5555555555555541, 0x5455555555555555, 0x5555555551541001, 0x0005555555555505 },
+        { 0x5555555555555551, 0x1455555555555555, 0x5555415551555401, 0x5555555555555505 },
+        { 0x5555555555555545, 0x5555555555555555, 0x5555555551555554, 0x5555555555555555 },
+        { 0x5555555555555454, 0x0455555555555555, 0x5555415550040554, 0x5555555555555505 },
+        { 0x5555555555555551, 0x1455555555555555, 0x5555555550554555, 0x5555555555555505 },
+        { 0x5555555555555550, 0x5415555555555555, 0x5555555551555401, 0x5555555555555505 },
+        { 0x5555555555555551, 0x5555555555555555, 0x5555440555455555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5540005155555555, 0x5555555540001555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5400005155555555, 0x5555555550005555, 0x5555555555555555 },
+        { 0x5550555555555555, 0x5551115555555555, 0x5555555555555555, 0x4000000155555555 },
+        { 0x0001000001550400, 0x5400000000000000, 0x5555555555554555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x4141000401555555, 0x0550555555555555, 0x5555540155555554 },
+        { 0x5155555551554145, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x0000000000000000 },
+        { 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000 },
+        { 0x5555555555555555, 0x5555555555555555, 0x0155555555555555, 0x5555555555555555 },
+        { 0x5555540555555555, 0x5555550555555555, 0x5555550555555555, 0x5555550555555555 },
+        { 0x5555555555555555, 0x5000105555555555, 0x5155550000014555, 0x5555555555555555 },
+        { 0x5555555500155555, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555554155, 0x5555555555515555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5501554555541540, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5514155555555555, 0x5555555555555555, 0x4000455555555555, 0x1400001554000144 },
+        { 0x5555555555555555, 0x0000000055555555, 0x5555555540000000, 0x5555555555555555 },
+        { 0x5555555555555500, 0x5440045555555555, 0x5555555555555545, 0x5555550000155555 },
+        { 0x5555555555555550, 0x5555555550105005, 0x5555555555555555, 0x5555555011504555 },
+        { 0x5555555555555555, 0x5555050000555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x0000004055555555, 0x5550545551540004 },
+        { 0x5555555555555555, 0x5555555555555555, 0x0000000000000000, 0x0000000000000000 },
+        { 0x5555555500155555, 0x5555555540055555, 0x5555555555555555, 0x5555555500000400 },
+        { 0x5555555555555555, 0x5555555555555555, 0x0000000055555555, 0x5555555400000000 },
+        { 0x55a5555555555555, 0x5555555555695555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555559656a95555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x6955555555555555 },
+        { 0x55555a5555555555, 0x5555555555555555, 0x555555aaaaaa5555, 0x9555555555555555 },
+        { 0x5555559555555555, 0x6955555555a55559, 0x5555565565555a55, 0x596559a555655555 },
+        { 0x5555555555a55955, 0x5555555555565555, 0x55559a9566555555, 0x5555555555555555 },
+        { 0x5555a95555555555, 0x9555555655555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5695555555555555, 0x5555555555555555, 0x5555595655555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555555015555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x1555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x0000000000000000 },
+        { 0xaa9aaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x555555aaaaaaaaaa },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x55555aaaaaaaaaaa, 0x55aaaaaa55555555 },
+        { 0xaaaaaaaaaaaaaaaa, 0x6aaaaaaaa00aaaaa, 0xaaaaaaaaaaaaaaa9, 0xaaaaaaaaaaaaaaaa },
+        { 0xaa816aaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa },
+        { 0xaaaaaaaaaaaaa955, 0xaaaaaaa9aaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa },
+        { 0xaaaaaaaa6aaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaa555555aa },
+        { 0x6aaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaa5555aaaa, 0xaaaaaaaaaaaaaaaa },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x5555555555555555, 0x5555555555555555 },
+        { 0xaaaaaaaa56aaaaaa, 0xaaaaaaaaaaaaaaaa, 0x5555555555556aaa, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5000004015555555 },
+        { 0x0555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555555055555555 },
+        { 0x5555555555154545, 0x5555555554554155, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555055, 0x1555555000000000 },
+        { 0x5555555555555555, 0x5555555550000555, 0x5555555000001555, 0x56aaaaaaaaaaaaaa },
+        { 0x5555555555555540, 0x5050051555555555, 0x5555555555555555, 0x5555555555555155 },
+        { 0x5555555555555555, 0x5555414140015555, 0x5555555554555515, 0x5455555555555555 },
+        { 0x5555555555555555, 0x0554140455555555, 0x5555555555555551, 0x5555455550555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555555551545155 },
+        { 0xaaaaaaaaaaaaaaaa, 0x00000000555555aa, 0x0000000000154000, 0x5500000000000000 },
+        { 0x4555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x555aaaaa00000000, 0xaaaaaaaa00000000, 0xaaaaaa6aaaaaaaaa, 0x5555555555aa6aaa },
+        { 0xaaaaaaaaaaaaaaa9, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x5555555555555556 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5501555555556aaa },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5155555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555555555555554 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5540055555555555 },
+        { 0x5555555500554101, 0x1540555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555555555554155 },
+        { 0x5555555555555555, 0x5555555555550055, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555554155555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555400000555, 0x5555555555555555 },
+        { 0x5555555555555005, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555551, 0x0000555555555555, 0x5555555555554000, 0x1555541455555555 },
+        { 0x5555555555555550, 0x5541401555555555, 0x5555555555555545, 0x5555555555555555 },
+        { 0x5555555555555540, 0x5555540001001555, 0x5555555555555555, 0x5555551555555555 },
+        { 0x5555555555555550, 0x4000055555555555, 0x5555555514015555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x4555045015555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x1555555555555555, 0x5555555555400015 },
+        { 0x5555555555555550, 0x5415555555555555, 0x5555555555555554, 0x5555540054000555 },
+        { 0x5555555555555555, 0x0000555555555555, 0x4555555555554405, 0x5555555555555555 },
+        { 0x5555555555555555, 0x1544001555555555, 0x5555555555555504, 0x5555555555555555 },
+        { 0x5555555555555555, 0x1055500555555555, 0x5055555555555554, 0x5555555555555555 },
+        { 0x5555555555555555, 0x1140001555555555, 0x5555555555555554, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555100051155555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x0155555555555555, 0x5555555555001005, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5541000015555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x4415555555555555, 0x5555555555555515, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5505005555555555, 0x5555555555555554 },
+        { 0x5555555555400001, 0x4014001555555555, 0x5501400155551555, 0x5555555555555555 },
+        { 0x5550400000055555, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x1000400055555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x0000000555555555, 0x5555410400050000, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x1045400155555555, 0x5555555555551000, 0x5555555555555555 },
+        { 0x5555115055555555, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555541555555555 },
+        { 0x5555555555555555, 0x5554000055555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555540055555555 },
+        { 0x5555555555555555, 0x5555400055555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555515555555, 0x5555555555555555 },
+        { 0x5555554015555555, 0x5555555555555555, 0x5555555555555555, 0x5555555a555554aa },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x5555aaaaaaaaaaaa },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x55555aaaaaaaaaaa, 0x5555555555555555 },
+        { 0x555555555556aaaa, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x69aaa9aa55555555 },
+        { 0xaaaaaaaaaaaaaaaa, 0x555555555555556a, 0x5555556a55555555, 0xaaaaaaaa5555aa55 },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x55aaaaaaaaaaaaaa },
+        { 0x4155555555555555, 0x5555555555555500, 0x5555555555555555, 0x5555555555555555 },
+        { 0x0000000000000000, 0x0000000050000000, 0x5555555555554000, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x0000001555501555 },
+        { 0x5555555555000140, 0x5555555550055555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555405, 0x5555555555555555 },
+        { 0x0000000000000000, 0x0015400000000000, 0x0000000000000000, 0x5555515554000000 },
+        { 0x0015555555555455, 0x5555555500000001, 0x5555555555555555, 0x5555555555555555 },
+        { 0x0014000000004000, 0x5555555555400410, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555545555555, 0x5555555555555555, 0x5555555500555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555400055555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555400055, 0x5555555555555555 },
+        { 0x5555555555555655, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555595555555, 0x5555555555555555 },
+        { 0x556aaaa965555555, 0x5555555555555555, 0x5555555555555555, 0x5555555555555555 },
+        { 0xaaaaaaaa5555556a, 0x55aaaaaaaaaaaaaa, 0x5555555a5556aaaa, 0x5555555555555aaa },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaa9aaaa9555556, 0xaaaaaaaaaaaaaaaa, 0xa6aaaaaaaaaaaaaa },
+        { 0x555555aaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x555555aa956aaaaa, 0xaaaa5656aaaaaaaa },
+        { 0xaaaaaaaaaaaaaaaa, 0x6aaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaa6, 0xaaaaaaaaaaaaaaaa },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x96aaaaaaaaaaaaaa },
+        { 0xaaaaaaaaaaaaaaaa, 0x5aaaaaaaaaaaaaaa, 0xaaaaaaaa6a955555, 0x556555555555aaaa },
+        { 0x5555695555555555, 0x5555555555555655, 0x5555555555555555, 0xaa95555555555555 },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x55555555aaaaaaaa, 0x5555555555555555 },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xa955a96a56555aaa, 0x56aaaa5556955555 },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x5555555655aaaaaa },
+        { 0xaaaaaaaaaa555555, 0xaa6aaaaaaaaaaaaa, 0xaaaaaaaaaaaa9aaa, 0xaaaaaaaaaaaaaaaa },
+        { 0x5555555555555555, 0x5555555555555555, 0x5555555555555555, 0x56aa56aa55555555 },
+        { 0xaaaaaaaa55556aaa, 0x556aaaaa56aaaaaa, 0x555aaaaa55555aaa, 0x55556aaa5555aaaa },
+        { 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0xaaaaaaaaaaaaaaaa, 0x5aaaaaaaaaaaaaaa }
+    };
+
+    /// Length of the run of ASCII bytes `[p, p + n)` starts with.
+    inline size_t asciiPrefixGeneric(const char* p, size_t n) {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            if (word & 0x8080808080808080ull)
+                break;
+        }
+        while (i < n && static_cast<unsigned char>(p[i]) < 0x80)
+            ++i;
+        return i;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    CCUTILS_TARGET_SSE42 inline size_t asciiPrefixSse42(const char* p, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            if (uint32_t mask = _mm_movemask_epi8(bytes))
+                return i + __builtin_ctz(mask);
+        }
+        return i + asciiPrefixGeneric(p + i, n - i);
+    }
+
+    CCUTILS_TARGET_AVX2 inline size_t asciiPrefixAvx2(const char* p, size_t n) {
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            if (uint32_t mask = _mm256_movemask_epi8(bytes))
+                return i + __builtin_ctz(mask);
+        }
+        return i + asciiPrefixSse42(p + i, n - i);
+    }
+
+    inline Dispatched<size_t(const char*, size_t)> asciiPrefix { asciiPrefixGeneric, asciiPrefixSse42,
+        asciiPrefixAvx2 };
+#else
+    inline Dispatched<size_t(const char*, size_t)> asciiPrefix { asciiPrefixGeneric };
+#endif
+
+} // namespace detail
+
+/// Length of the run of ASCII bytes `s` starts with: 16 or 32 bytes are tested at a time with SIMD.
+inline size_t asciiPrefix(std::string_view s) { return detail::asciiPrefix(s.data(), s.size()); }
+
+/** The columns code point `cp` takes on a terminal: 0 for combining marks and other zero-width characters, 2 for
+ *  East Asian Wide and Fullwidth characters, 1 for the rest. Control characters are 1 as well, as every ASCII byte
+ *  is one column. Two table lookups; past U+3FFFF only the tags and variation selectors of plane 14 are not 1.
+ **/
+inline int codePointWidth(char32_t cp) {
+    if (cp < 0x40000) {
+        const uint64_t word = detail::WIDTH_BLOCKS[detail::WIDTH_INDEX[cp >> 7]][(cp >> 5) & 3];
+        return int(word >> ((cp & 31) * 2)) & 3;
+    }
+    return cp >= 0xe0000 && cp <= 0xe0fff ? 0 : 1;
+}
+
+/// Whether `s` is well-formed UTF-8. Runs of ASCII are skipped with \c asciiPrefix.
+inline bool isValidUtf8(std::string_view s) {
+    size_t i = 0;
+    while (i < s.size()) {
+        if (static_cast<unsigned char>(s[i]) < 0x80) {
+            i += detail::asciiPrefix(s.data() + i, s.size() - i);
+            continue;
+        }
+        char32_t cp;
+        const size_t length = decodeUtf8(s.data() + i, s.size() - i, cp);
+        if (length == 1)
+            return false;
+        i += length;
+    }
+    return true;
+}
+
+/// A prefix of a string: its length in bytes and the columns it takes on a terminal.
+struct DisplayFit {
+    size_t bytes;
+    size_t columns;
+};
+
+/** The longest prefix of `s` that takes at most `width` columns, in whole code points. The zero-width code points
+ *  that follow the last one, such as its combining marks, are part of it. Invalid bytes are one column each, as
+ *  U+FFFD. ASCII is measured with \c asciiPrefix, and only the rest is decoded.
+ **/
+inline DisplayFit fitDisplayWidth(std::string_view s, size_t width) {
+    size_t i = 0;
+    size_t columns = 0;
+    while (i < s.size()) {
+        if (static_cast<unsigned char>(s[i]) < 0x80) {
+            if (columns == width)
+                break;
+            const size_t ascii = detail::asciiPrefix(s.data() + i, std::min(s.size() - i, width - columns));
+            i += ascii;
+            columns += ascii;
+            continue;
+        }
+        char32_t cp;
+        const size_t length = decodeUtf8(s.data() + i, s.size() - i, cp);
+        const size_t w = codePointWidth(cp);
+        if (columns + w > width)
+            break;
+        i += length;
+        columns += w;
+    }
+    return { i, columns };
+}
+
+/// The columns `s` takes on a terminal, as UTF-8.
+inline size_t displayWidth(std::string_view s) { return fitDisplayWidth(s, s.size() * 2).columns; }
+
+} // namespace ccutils
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+// Per-function target attributes for the variants of a dispatched kernel. A function compiled with one of these may
+// use the corresponding intrinsics even if the translation unit isn't compiled with -mavx2 etc.
+#define CCUTILS_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define CCUTILS_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,fma,popcnt")))
+#define CCUTILS_TARGET_AVX512 \
+    __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq,avx512cd,avx2,bmi,bmi2,fma,popcnt")))
+
+namespace ccutils {
+
+/// Instruction set levels kernels are specialized for, from least to most capable.
+enum class Isa : uint8_t {
+    GENERIC,
+    SSE42,
+    AVX2,
+    AVX512,
+};
+
+inline const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::SSE42:
+        return "sse42";
+    case Isa::AVX2:
+        return "avx2";
+    case Isa::AVX512:
+        return "avx512";
+    default:
+        return "generic";
+    }
+}
+
+/** What the CPU and the OS support. AVX features only count when the OS saves the corresponding registers on
+ *  context switches (checked with xgetbv), which is what makes them usable rather than merely present.
+ **/
+struct CpuFeatures {
+    bool sse2 = false;
+    bool sse3 = false;
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool sse42 = false;
+    bool popcnt = false;
+    bool avx = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool bmi1 = false;
+    bool bmi2 = false;
+    bool avx512f = false;
+    bool avx512dq = false;
+    bool avx512cd = false;
+    bool avx512bw = false;
+    bool avx512vl = false;
+    bool avx512vbmi = false;
+
+    /// The highest level all of whose features are available.
+    Isa level() const {
+        if (!(sse42 && popcnt))
+            return Isa::GENERIC;
+        if (!(avx2 && fma && bmi1 && bmi2))
+            return Isa::SSE42;
+        if (!(avx512f && avx512dq && avx512cd && avx512bw && avx512vl))
+            return Isa::AVX2;
+        return Isa::AVX512;
+    }
+
+    /// Queries CPUID. Has no dependencies on other globals, so it is safe to call from an ifunc resolver.
+    static CpuFeatures detect() {
+        CpuFeatures f;
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return f;
+
+        f.sse2 = edx & (1u << 26);
+        f.sse3 = ecx & (1u << 0);
+        f.ssse3 = ecx & (1u << 9);
+        f.sse41 = ecx & (1u << 19);
+        f.sse42 = ecx & (1u << 20);
+        f.popcnt = ecx & (1u << 23);
+        const bool fma = ecx & (1u << 12);
+        const bool osxsave = ecx & (1u << 27);
+        const bool avx = ecx & (1u << 28);
+
+        uint64_t xcr0 = 0;
+        if (osxsave) {
+            uint32_t lo, hi;
+            __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            xcr0 = (uint64_t(hi) << 32) | lo;
+        }
+        // XMM and YMM state; additionally opmask, ZMM_Hi256 and Hi16_ZMM state for AVX-512.
+        const bool osAvx = (xcr0 & 0x6) == 0x6;
+        const bool osAvx512 = (xcr0 & 0xe6) == 0xe6;
+
+        f.avx = avx && osAvx;
+        f.fma = fma && osAvx;
+
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            f.bmi1 = ebx & (1u << 3);
+            f.bmi2 = ebx & (1u << 8);
+            f.avx2 = (ebx & (1u << 5)) && osAvx;
+            f.avx512f = (ebx & (1u << 16)) && osAvx512;
+            f.avx512dq = (ebx & (1u << 17)) && osAvx512;
+            f.avx512cd = (ebx & (1u << 28)) && osAvx512;
+            f.avx512bw = (ebx & (1u << 30)) && osAvx512;
+            f.avx512vl = (ebx & (1u << 31)) && osAvx512;
+            f.avx512vbmi = (ecx & (1u << 1)) && osAvx512;
+        }
+#endif
+        return f;
+    }
+};
+
+/// Features of the CPU we're running on, detected once.
+inline const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = CpuFeatures::detect();
+    return features;
+}
+
+/** The level kernels should be dispatched to: the hardware level, lowered by the `CCUTILS_FORCE_ISA` environment
+ *  variable (`generic`, `sse42`, `avx2` or `avx512`) if set. Forcing a level the CPU doesn't have is ignored, so the
+ *  variable can only be used to test the slower paths on a fast machine.
+ **/
+inline Isa dispatchIsa() {
+    static const Isa isa = [] {
+        Isa best = cpuFeatures().level();
+        const char* forced = std::getenv("CCUTILS_FORCE_ISA");
+        if (!forced)
+            return best;
+        for (Isa isa : {Isa::GENERIC, Isa::SSE42, Isa::AVX2, Isa::AVX512}) {
+            if (std::strcmp(forced, isaName(isa)) == 0)
+                return isa < best ? isa : best;
+        }
+        return best;
+    }();
+    return isa;
+}
+
+/** Picks the best of the given variants for `isa`; variants may be null when a level has no specialization. **/
+template <typename Fn>
+Fn selectVariant(Isa isa, Fn generic, Fn sse42 = nullptr, Fn avx2 = nullptr, Fn avx512 = nullptr) {
+    if (isa >= Isa::AVX512 && avx512)
+        return avx512;
+    if (isa >= Isa::AVX2 && avx2)
+        return avx2;
+    if (isa >= Isa::SSE42 && sse42)
+        return sse42;
+    return generic;
+}
+
+template <typename Signature> class Dispatched;
+
+/** A function pointer resolved to the best variant on the first call, then called directly. Constant-initialized,
+ *  so it can be used from other static initializers.
+ *
+ *  \example
+ *  \code
+ *  size_t countGeneric(const char* p, size_t n);
+ *  CCUTILS_TARGET_AVX2 size_t countAvx2(const char* p, size_t n);
+ *
+ *  inline Dispatched<size_t(const char*, size_t)> count{countGeneric, nullptr, countAvx2};
+ *  \endcode
+ *
+ *  Code that lives in a .cpp file can use a GNU ifunc instead, which resolves the symbol at load time and costs
+ *  nothing per call. Resolvers run before the environment is set up, so they only see the hardware:
+ *  \code
+ *  extern "C" auto resolveCount() { return selectVariant(CpuFeatures::detect().level(), countGeneric, ...); }
+ *  size_t count(const char* p, size_t n) __attribute__((ifunc("resolveCount")));
+ *  \endcode
+ **/
+template <typename R, typename... Args> class Dispatched<R(Args...)> {
+public:
+    using Fn = R (*)(Args...);
+
+    constexpr Dispatched(Fn generic, Fn sse42 = nullptr, Fn avx2 = nullptr, Fn avx512 = nullptr)
+        : variants_{generic, sse42, avx2, avx512} {}
+
+    R operator()(Args... args) const {
+        Fn fn = resolved_.load(std::memory_order_relaxed);
+        if (__builtin_expect(fn == nullptr, 0))
+            fn = resolve();
+        return fn(std::forward<Args>(args)...);
+    }
+
+    /// The variant calls go to.
+    Fn resolve() const {
+        Fn fn = selectVariant(dispatchIsa(), variants_[0], variants_[1], variants_[2], variants_[3]);
+        resolved_.store(fn, std::memory_order_relaxed);
+        return fn;
+    }
+
+private:
+    Fn variants_[4];
+    mutable std::atomic<Fn> resolved_{nullptr};
+};
+
+} // namespace ccutils
@@ -1,50 +1,162 @@
 #pragma once
-#include <iostream>
+
+#include <cstddef>
+#include <iterator>
+#include <ostream>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ccutils {
+
+/** How \c TreeDumper walks a tree of `Node`: `childCount(node)`, `child(node, i)`, a pointer that may be null, and
+ *  `value(node)`, what is written for it. Binary nodes with `left` and `right` and n-ary nodes with an indexable
+ *  `children` are handled, each with a `val`; other trees specialize this.
+ *
+ *  \code
+ *  template <> struct ccutils::TreeTraits<Directory> {
+ *      static size_t childCount(Directory const& dir) { return dir.entries.size(); }
+ *      static Directory const* child(Directory const& dir, size_t i) { return dir.entries[i].get(); }
+ *      static std::string const& value(Directory const& dir) { return dir.name; }
+ *  };
+ *  \endcode
+ **/
+template <class Node, class = void> struct TreeTraits {};
+
+namespace detail {
+
+    /// A child as a pointer, whether it is held by pointer, smart pointer or value.
+    template <class Node, class Child> Node const* treeChild(Child const& child) {
+        if constexpr (std::is_pointer_v<Child>)
+            return child;
+        else if constexpr (std::is_same_v<Child, Node>)
+            return &child;
+        else
+            return child.get();
+    }
 
-struct Trunk {
-    Trunk* prev;
-    std::string str;
+} // namespace detail
 
-    Trunk(Trunk* prev, std::string str) {
-        this->prev = prev;
-        this->str = str;
+template <class Node>
+struct TreeTraits<Node,
+    std::void_t<decltype(std::declval<Node const&>().left), decltype(std::declval<Node const&>().right)>> {
+    static constexpr size_t childCount(Node const&) { return 2; }
+    static Node const* child(Node const& node, size_t i) {
+        return i == 0 ? detail::treeChild<Node>(node.left) : detail::treeChild<Node>(node.right);
     }
+    static auto const& value(Node const& node) { return node.val; }
 };
 
-// Helper function to print branches of the binary tree
-void showTrunks(std::ostream& os, Trunk* p, int first = 1) {
-    if (p == nullptr)
-        return;
-    showTrunks(os, p->prev, 0);
-    os << p->str.substr(0, p->str.size() - first);
-}
+template <class Node> struct TreeTraits<Node, std::void_t<decltype(std::declval<Node const&>().children[0])>> {
+    static size_t childCount(Node const& node) { return std::size(node.children); }
+    static Node const* child(Node const& node, size_t i) { return detail::treeChild<Node>(node.children[i]); }
+    static auto const& value(Node const& node) { return node.val; }
+};
 
-template <typename T>
-void dump(std::ostream& os, T* root, Trunk* prev = nullptr, bool left = true) {
-    if (root == nullptr)
-        return;
-    std::string prev_str = "    ";
-    Trunk* trunk = new Trunk(prev, prev_str);
-    dump(os, root->left, trunk, true);
-    if (!prev)
-        trunk->str = "----";
-    else if (left) {
-        trunk->str = ".---";
-        prev_str = "   |";
-    } else {
-        trunk->str = "`---";
-        prev->str = prev_str;
+/** Writes a tree a node a line, the root first and each node's children below it, a level every 4 columns, in the
+ *  layout print.hpp uses for %#$:
+ *
+ *  \code
+ *  8
+ *  |---3
+ *  |   |---1
+ *  |   `---6
+ *  `---10
+ *      |---
+ *      `---14
+ *  \endcode
+ *
+ *  A null child is an empty branch, so that the left and right of a binary node stay apart, but a node whose children
+ *  are all null is a leaf. The nodes are walked with a stack of their own and the prefix of a line is one string,
+ *  grown and cut back a level at a time, so depth costs no call stack, and a dumper kept between dumps does not
+ *  allocate once these have grown to the depth of the trees.
+ **/
+template <class Node> class TreeDumper {
+public:
+    using Traits = TreeTraits<Node>;
+
+    static constexpr size_t NO_LIMIT = ~size_t(0);
+
+    /// Writes the tree under `root` to `os`. The children of the nodes `maxDepth` levels below it are left out, with
+    /// a branch to "..." in their place.
+    void dump(std::ostream& os, Node const* root, size_t maxDepth = NO_LIMIT) {
+        if (root == nullptr)
+            return;
+        stack_.clear();
+        prefix_.clear();
+        os << Traits::value(*root) << '\n';
+        enter(os, *root, maxDepth, true);
+
+        while (!stack_.empty()) {
+            Frame& top = stack_.back();
+            if (top.next == top.count) {
+                stack_.pop_back();
+                if (!stack_.empty())
+                    prefix_.resize(prefix_.size() - 4);
+                continue;
+            }
+            Node const* child = Traits::child(*top.node, top.next++);
+            const bool last = top.next == top.count;
+            os.write(prefix_.data(), prefix_.size());
+            os.write(last ? "`---" : "|---", 4);
+            if (child == nullptr) {
+                os.put('\n');
+                continue;
+            }
+            os << Traits::value(*child) << '\n';
+            enter(os, *child, maxDepth, last);
+        }
+    }
+
+private:
+    struct Frame {
+        Node const* node;
+        size_t next;
+        size_t count;
+    };
+
+    static bool hasChildren(Node const& node) {
+        for (size_t i = 0, count = Traits::childCount(node); i < count; ++i) {
+            if (Traits::child(node, i) != nullptr)
+                return true;
+        }
+        return false;
+    }
+
+    /// Goes on to the children of `node`, just written, which is the `last` child of its parent.
+    void enter(std::ostream& os, Node const& node, size_t maxDepth, bool last) {
+        if (!hasChildren(node))
+            return;
+        const size_t depth = stack_.size();
+        const char* trunk = last ? "    " : "|   ";
+        if (depth >= maxDepth) {
+            os.write(prefix_.data(), prefix_.size());
+            if (depth > 0)
+                os.write(trunk, 4);
+            os.write("`---...\n", 8);
+            return;
+        }
+        if (depth > 0)
+            prefix_.append(trunk, 4);
+        stack_.push_back({ &node, 0, Traits::childCount(node) });
     }
-    showTrunks(os, trunk);
-    std::cerr << root->val << std::endl;
-    if (prev)
-        prev->str = prev_str;
-    trunk->str = "   |";
-    dump(os, root->right, trunk, false);
+
+    std::vector<Frame> stack_;
+    std::string prefix_;
+};
+
+} // namespace ccutils
+
+/// Writes the tree under `root` to `os` with a \c ccutils::TreeDumper, down to `maxDepth` levels below it.
+template <typename T>
+void dump(std::ostream& os, T* root, size_t maxDepth = ccutils::TreeDumper<std::remove_const_t<T>>::NO_LIMIT) {
+    ccutils::TreeDumper<std::remove_const_t<T>>().dump(os, root, maxDepth);
 }
 
-template <typename T> inline static std::ostream& operator<<(std::ostream& os, T* root) noexcept {
+/// Writes the tree under `root`, for the node types \c ccutils::TreeTraits knows.
+template <typename T, typename = decltype(ccutils::TreeTraits<std::remove_const_t<T>>::value(std::declval<T&>()))>
+inline std::ostream& operator<<(std::ostream& os, T* root) {
     dump(os, root);
     return os;
 }
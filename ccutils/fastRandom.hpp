@@ -0,0 +1,280 @@
+#pragma once
+
+#include "macros.hpp"
+#include "random.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace ccutils {
+
+/** Eight xoshiro256** generators stepped in lockstep. The state is stored lane-wise in two groups of four GCC vector
+ *  lanes, so every step is a handful of SIMD instructions on whatever the target supports: one AVX2 register or two
+ *  SSE2 registers per group, and both groups fused when compiled for AVX-512.
+ *
+ *  Lane `i` starts from the seed state jumped `i` times, so the lanes are non-overlapping xoshiro256** streams.
+ *  The output is not the same sequence as a single \c Xoshiro256StarStar.
+ *
+ *  Not a cryptographic generator; use \c randomFill for keys and nonces.
+ **/
+class XoshiroLanes {
+public:
+    static constexpr std::size_t LANES = 8;
+    static constexpr std::size_t BLOCK_SIZE = LANES * sizeof(std::uint64_t);
+
+    explicit XoshiroLanes(Xoshiro256StarStar seed) {
+        std::uint64_t words[4][LANES];
+        for (std::size_t lane = 0; lane < LANES; ++lane) {
+            for (int i = 0; i < 4; ++i)
+                words[i][lane] = seed.s_[i];
+            seed.jump();
+        }
+        std::memcpy(s0_, words[0], BLOCK_SIZE);
+        std::memcpy(s1_, words[1], BLOCK_SIZE);
+        std::memcpy(s2_, words[2], BLOCK_SIZE);
+        std::memcpy(s3_, words[3], BLOCK_SIZE);
+    }
+
+    /** Writes one output of every lane, \c BLOCK_SIZE bytes in total, to `out`. **/
+    ALWAYS_INLINE void next(void* out) {
+        for (std::size_t g = 0; g < GROUPS; ++g) {
+            // `* 5` and `* 9` spelled as shifts so that targets without a 64-bit vector multiply don't fall back
+            // to scalar code.
+            Vector x = (s1_[g] << 2) + s1_[g];
+            x = (x << 7) | (x >> 57);
+            const Vector result = (x << 3) + x;
+            const Vector t = s1_[g] << 17;
+
+            s2_[g] ^= s0_[g];
+            s3_[g] ^= s1_[g];
+            s1_[g] ^= s2_[g];
+            s0_[g] ^= s3_[g];
+            s2_[g] ^= t;
+            s3_[g] = (s3_[g] << 45) | (s3_[g] >> 19);
+
+            std::memcpy(static_cast<char*>(out) + g * sizeof(Vector), &result, sizeof(Vector));
+        }
+    }
+
+    /** Fills `[begin, end)` with random bytes. **/
+    void fill(char* begin, char* end) {
+        while (end - begin >= static_cast<std::ptrdiff_t>(BLOCK_SIZE)) {
+            next(begin);
+            begin += BLOCK_SIZE;
+        }
+        if (begin < end) {
+            char block[BLOCK_SIZE];
+            next(block);
+            std::memcpy(begin, block, end - begin);
+        }
+    }
+
+private:
+#ifdef __AVX512F__
+    static constexpr std::size_t GROUPS = 1;
+#else
+    static constexpr std::size_t GROUPS = 2;
+#endif
+
+    using Vector = std::uint64_t __attribute__((vector_size(BLOCK_SIZE / GROUPS)));
+
+    Vector s0_[GROUPS], s1_[GROUPS], s2_[GROUPS], s3_[GROUPS];
+};
+
+namespace detail {
+
+inline XoshiroLanes& threadLanes() {
+    thread_local XoshiroLanes lanes(randomSeeded<Xoshiro256StarStar>());
+    return lanes;
+}
+
+/** Lemire's nearly divisionless reduction of a 64-bit random word to `[0, range)`. `range == 0` stands for the full
+ *  2^64 range. The division only happens on the rare path where the low half falls below `range`. **/
+template <typename TNext>
+inline std::uint64_t boundedRandom(std::uint64_t range, std::uint64_t word, TNext&& next) {
+    if (range == 0)
+        return word;
+    __uint128_t m = __uint128_t(word) * range;
+    std::uint64_t low = std::uint64_t(m);
+    if (__builtin_expect(low < range, 0)) {
+        const std::uint64_t threshold = -range % range;
+        while (low < threshold) {
+            m = __uint128_t(next()) * range;
+            low = std::uint64_t(m);
+        }
+    }
+    return std::uint64_t(m >> 64);
+}
+
+/** `mulLow32(a, b)` is the 64-bit products of the low 32 bits of each lane, a single `pmuludq` on x86. **/
+#if defined(__AVX2__)
+using ProductVector = std::uint64_t __attribute__((vector_size(32)));
+
+ALWAYS_INLINE inline ProductVector mulLow32(ProductVector a, ProductVector b) {
+    return ProductVector(_mm256_mul_epu32(__m256i(a), __m256i(b)));
+}
+#elif defined(__SSE2__)
+using ProductVector = std::uint64_t __attribute__((vector_size(16)));
+
+ALWAYS_INLINE inline ProductVector mulLow32(ProductVector a, ProductVector b) {
+    return ProductVector(_mm_mul_epu32(__m128i(a), __m128i(b)));
+}
+#else
+using ProductVector = std::uint64_t __attribute__((vector_size(16)));
+
+ALWAYS_INLINE inline ProductVector mulLow32(ProductVector a, ProductVector b) {
+    return (a & 0xffffffff) * (b & 0xffffffff);
+}
+#endif
+
+using OffsetVector = std::uint32_t __attribute__((vector_size(sizeof(ProductVector))));
+
+/** \c uniformInts for a range below 2^32. Each word of a \c XoshiroLanes block is two 32-bit draws, reduced with
+ *  Lemire's method a vector at a time: a 32x32-bit product is one `pmuludq` per pair of lanes, the rejection threshold
+ *  is computed once per call rather than per value, and the high halves of the products are the offsets from `lo`.
+ *  The rare rejected draws are redone one at a time. **/
+template <typename T>
+void uniformInts32(T* first, T* last, T lo, std::uint32_t range) {
+    using U = std::make_unsigned_t<T>;
+    constexpr std::size_t DRAWS = 2 * XoshiroLanes::LANES;
+    constexpr std::size_t VECTORS = XoshiroLanes::BLOCK_SIZE / sizeof(ProductVector);
+    constexpr std::uint64_t LOW = 0xffffffff;
+    const std::uint64_t threshold = std::uint32_t(-range) % range;
+    const ProductVector ranges = ProductVector{} + range;
+
+    XoshiroLanes& lanes = threadLanes();
+    std::uint32_t spare[DRAWS];
+    std::size_t used = DRAWS;
+    auto redraw = [&](std::uint64_t& product) {
+        while ((product & LOW) < threshold) {
+            if (used == DRAWS) {
+                lanes.next(spare);
+                used = 0;
+            }
+            product = std::uint64_t(spare[used++]) * range;
+        }
+    };
+
+    while (first != last) {
+        ProductVector words[VECTORS], even[VECTORS], odd[VECTORS], rejected = {};
+        lanes.next(words);
+        for (std::size_t j = 0; j < VECTORS; ++j) {
+            even[j] = mulLow32(words[j], ranges);
+            odd[j] = mulLow32(words[j] >> 32, ranges);
+            // the low halves are below 2^32, so the top bit is set where they are below the threshold
+            rejected |= ((even[j] & LOW) - threshold) | ((odd[j] & LOW) - threshold);
+        }
+        std::uint64_t any = 0;
+        for (std::size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); ++i)
+            any |= rejected[i];
+        if (__builtin_expect(any >> 63, 0)) {
+            for (std::size_t j = 0; j < VECTORS; ++j) {
+                for (std::size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); ++i) {
+                    redraw(even[j][i]);
+                    redraw(odd[j][i]);
+                }
+            }
+        }
+
+        OffsetVector offsets[VECTORS];
+        for (std::size_t j = 0; j < VECTORS; ++j)
+            offsets[j] = OffsetVector((even[j] >> 32) | (odd[j] & ~LOW));
+        if (last - first >= static_cast<std::ptrdiff_t>(DRAWS)) {
+            if constexpr (sizeof(T) == sizeof(std::uint32_t)) {
+                for (auto& offset : offsets)
+                    offset += U(lo);
+                std::memcpy(first, offsets, sizeof(offsets));
+            } else {
+                const auto* values = reinterpret_cast<const std::uint32_t*>(offsets);
+                for (std::size_t i = 0; i < DRAWS; ++i)
+                    first[i] = T(U(lo) + U(values[i]));
+            }
+            first += DRAWS;
+        } else {
+            const auto* values = reinterpret_cast<const std::uint32_t*>(offsets);
+            for (std::size_t i = 0; first != last; ++i, ++first)
+                *first = T(U(lo) + U(values[i]));
+        }
+    }
+}
+
+}  // namespace detail
+
+/** Fills `[begin, end)` with non-cryptographic random bytes from a per-thread \c XoshiroLanes. Many times faster than
+ *  \c randomFill, which goes to the kernel for every call. **/
+inline void fastRandomFill(char* begin, char* end) {
+    detail::threadLanes().fill(begin, end);
+}
+
+/** Fills `[first, last)` with integers uniformly distributed in `[lo, hi]`, drawing from the per-thread
+ *  \c XoshiroLanes one block at a time. Ranges below 2^32 are reduced a block at a time in vector lanes; wider ones
+ *  take a 64-bit multiply per value. **/
+template <typename T>
+void uniformInts(T* first, T* last, T lo, T hi) {
+    static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(std::uint64_t), "uniformInts needs an integer type");
+    using U = std::make_unsigned_t<T>;
+    // subtracted as U so that 8- and 16-bit types don't promote to a negative int; wraps to 0 for the full 64-bit range
+    const std::uint64_t range = std::uint64_t(U(U(hi) - U(lo))) + 1;
+    if (range != 0 && range <= std::numeric_limits<std::uint32_t>::max()) {
+        detail::uniformInts32(first, last, lo, std::uint32_t(range));
+        return;
+    }
+
+    XoshiroLanes& lanes = detail::threadLanes();
+    std::uint64_t block[XoshiroLanes::LANES];
+    lanes.next(block);
+    std::size_t used = 0;
+    auto next = [&]() -> std::uint64_t {
+        if (used == XoshiroLanes::LANES) {
+            lanes.next(block);
+            used = 0;
+        }
+        return block[used++];
+    };
+    for (; first != last; ++first)
+        *first = T(U(lo) + U(detail::boundedRandom(range, next(), next)));
+}
+
+/** Same, drawing from an arbitrary 64-bit UniformRandomBitGenerator. **/
+template <typename T, typename TRandomNumberEngine>
+void uniformInts(T* first, T* last, T lo, T hi, TRandomNumberEngine& rng) {
+    static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(std::uint64_t), "uniformInts needs an integer type");
+    static_assert(TRandomNumberEngine::min() == 0
+                      && TRandomNumberEngine::max() == std::numeric_limits<std::uint64_t>::max(),
+                  "uniformInts needs a generator of full 64-bit words");
+    using U = std::make_unsigned_t<T>;
+    const std::uint64_t range = std::uint64_t(U(U(hi) - U(lo))) + 1;
+    auto next = [&]() -> std::uint64_t { return rng(); };
+    for (; first != last; ++first)
+        *first = T(U(lo) + U(detail::boundedRandom(range, rng(), next)));
+}
+
+/** Fills `[first, last)` with doubles uniformly distributed in `[0, 1)`, using the top 53 bits of each word. **/
+inline void uniformDoubles(double* first, double* last) {
+    XoshiroLanes& lanes = detail::threadLanes();
+    std::uint64_t block[XoshiroLanes::LANES];
+    for (; last - first >= static_cast<std::ptrdiff_t>(XoshiroLanes::LANES); first += XoshiroLanes::LANES) {
+        lanes.next(block);
+        for (std::size_t i = 0; i < XoshiroLanes::LANES; ++i)
+            first[i] = double(block[i] >> 11) * 0x1.0p-53;
+    }
+    if (first != last) {
+        lanes.next(block);
+        for (std::size_t i = 0; first != last; ++i, ++first)
+            *first = double(block[i] >> 11) * 0x1.0p-53;
+    }
+}
+
+template <typename TRandomNumberEngine>
+void uniformDoubles(double* first, double* last, TRandomNumberEngine& rng) {
+    for (; first != last; ++first)
+        *first = double(rng() >> 11) * 0x1.0p-53;
+}
+
+}  // namespace ccutils
@@ -2,11 +2,21 @@
 
 #include "macros.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <utility>
 
 namespace ccutils {
 
+/** Walks `[first, last)` calling the function matching the largest type in `TFArgs` whose size the current
+ *  position is aligned to and that still fits, e.g. `forEachAligned<__m256i, std::uint32_t, std::uint8_t>`. Types
+ *  are listed from largest to smallest, have power of two sizes and end with a single byte type. SIMD vector types
+ *  (`__m128i`, `__m256i`, `__m512i`) work like any other type.
+ *
+ *  The range is split up front into an unaligned prologue, an aligned body and a short epilogue, so the function for
+ *  the largest type runs in a loop without any alignment checks.
+ **/
 template <typename... TFArgs, typename... FApply>
 void forEachAligned(char* first, char* last, FApply&&... transform);
 
@@ -17,19 +27,27 @@ namespace detail {
 
 template <typename... TFArgs> struct forEachAlignedImpl;
 
-template <typename TFArg, typename... TFArgRest> struct forEachAlignedImpl<TFArg, TFArgRest...> {
+/// Splits `[first, last)` into a prologue up to the first address aligned for `TFArg`, an aligned body handled by
+/// `apply` in a tight loop, and an epilogue shorter than `TFArg`. The prologue and epilogue go to the smaller types.
+template <typename TFArg, typename TFArgNext, typename... TFArgRest>
+struct forEachAlignedImpl<TFArg, TFArgNext, TFArgRest...> {
     static constexpr std::size_t byte_align = sizeof(TFArg);
 
+    static_assert((byte_align & (byte_align - 1)) == 0, "forEachAligned types must have a power of two size");
+    static_assert(sizeof(TFArgNext) < byte_align, "forEachAligned types must be listed from largest to smallest");
+
     template <typename TChar, typename FApply, typename... FApplyRest>
-    ALWAYS_INLINE static TChar* step(
+    ALWAYS_INLINE static void run(
         TChar* first, TChar* last, const FApply& apply, const FApplyRest&... apply_rest) {
-        if (reinterpret_cast<std::uintptr_t>(first) % byte_align == 0
-            && first + byte_align <= last) {
-            apply(reinterpret_cast<TFArg*>(first));
-            return first + byte_align;
-        } else {
-            return forEachAlignedImpl<TFArgRest...>::step(first, last, apply_rest...);
-        }
+        auto addr = reinterpret_cast<std::uintptr_t>(first);
+        auto aligned = (addr + byte_align - 1) & ~std::uintptr_t(byte_align - 1);
+        TChar* body = first + std::min<std::uintptr_t>(aligned - addr, last - first);
+        TChar* body_end = body + (last - body) / byte_align * byte_align;
+
+        forEachAlignedImpl<TFArgNext, TFArgRest...>::run(first, body, apply_rest...);
+        for (; body != body_end; body += byte_align)
+            apply(reinterpret_cast<TFArg*>(body));
+        forEachAlignedImpl<TFArgNext, TFArgRest...>::run(body_end, last, apply_rest...);
     }
 };
 
@@ -37,17 +55,17 @@ template <typename T> struct forEachAlignedImpl<T> {
     static_assert(sizeof(T) == 1, "You must provide a single byte type to forEachAligned");
 
     template <typename TChar, typename FApply>
-    ALWAYS_INLINE static TChar* step(TChar* first, TChar*, const FApply& apply) {
-        apply(reinterpret_cast<T*>(first));
-        return first + 1;
+    ALWAYS_INLINE static void run(TChar* first, TChar* last, const FApply& apply) {
+        for (; first < last; ++first)
+            apply(reinterpret_cast<T*>(first));
     }
 };
 
 template <typename... TFArgs, typename TChar, typename... FApply>
 void forEachAligned(TChar* first, TChar* last, FApply&&... transform) {
-    for (; first < last; /* inline */) {
-        first = forEachAlignedImpl<TFArgs...>::step(first, last, transform...);
-    }
+    static_assert(sizeof...(TFArgs) == sizeof...(FApply), "forEachAligned needs one function per type");
+    if (first < last)
+        forEachAlignedImpl<TFArgs...>::run(first, last, transform...);
 }
 
 } // namespace detail
@@ -1,19 +1,34 @@
 // https://github.com/eteran/cxx17_printf
 #pragma once
 
+#include "formatFloat.hpp"
+
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <iterator>
+#include <ostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace ccutils {
 namespace print_detail {
 
-    // This context writes to a buffer
+    // This context writes to a buffer of size bytes, snprintf style: the output is
+    // truncated to size - 1 bytes and always terminated unless size is 0, while
+    // written counts every byte, so that it is the length the output would have
+    // had. Writes that fit, which is nearly all of them, take a single compare
+    // and an unclamped copy
     struct buffer_writer {
         buffer_writer(char* buffer, size_t size)
             : ptr_(buffer)
@@ -27,11 +42,37 @@ namespace print_detail {
             ++written;
         }
 
-        void write(const char* p, size_t n) {
-            size_t count = std::min(size_, n);
-            std::memcpy(ptr_, p, count);
-            size_ -= count;
+        void write(const char* p, size_t n) noexcept {
+            written += n;
+            if (n >= size_ && (n = room()) == 0) {
+                return;
+            }
+            std::memcpy(ptr_, p, n);
+            ptr_ += n;
+            size_ -= n;
+        }
+
+        void write(char ch, size_t count) noexcept {
             written += count;
+            if (count >= size_ && (count = room()) == 0) {
+                return;
+            }
+            std::memset(ptr_, ch, count);
+            ptr_ += count;
+            size_ -= count;
+        }
+
+        // where the next n bytes go, counted as written and left for the caller to
+        // fill, or nullptr if they would be truncated
+        char* reserve(size_t n) noexcept {
+            if (n >= size_) {
+                return nullptr;
+            }
+            char* p = ptr_;
+            ptr_ += n;
+            size_ -= n;
+            written += n;
+            return p;
         }
 
         void done() noexcept {
@@ -43,83 +84,158 @@ namespace print_detail {
         char* ptr_;
         size_t size_;
         size_t written = 0;
+
+    private:
+        // what is left of the buffer, keeping the last byte for the terminator
+        size_t room() const noexcept { return size_ > 1 ? size_ - 1 : 0; }
     };
 
-    // This context writes to a container using a std::back_inserter
-    struct ostream_writer {
-        ostream_writer(std::ostream& os)
-            : os_(os) {}
+    // Base of the contexts that write to a stream: output is staged in a buffer on
+    // the stack and handed to Derived::sink in bulk, so that each conversion costs a
+    // memcpy instead of a stream call per character. Derived flushes what is left
+    // in done() and in its destructor
+    template <class Derived> struct staged_writer {
+        static constexpr size_t BUFFER_SIZE = 1024;
 
         void write(char ch) {
-            os_.put(ch);
+            if (used_ == BUFFER_SIZE) {
+                flush();
+            }
+            buffer_[used_++] = ch;
             ++written;
         }
 
         void write(const char* p, size_t n) {
-            os_.write(p, n);
             written += n;
+            if (n > BUFFER_SIZE - used_) {
+                flush();
+                if (n >= BUFFER_SIZE) {
+                    static_cast<Derived*>(this)->sink(p, n);
+                    return;
+                }
+            }
+            std::memcpy(buffer_ + used_, p, n);
+            used_ += n;
         }
 
-        void done() noexcept {}
+        void write(char ch, size_t count) {
+            written += count;
+            while (count > 0) {
+                if (used_ == BUFFER_SIZE) {
+                    flush();
+                }
+                size_t n = std::min(count, BUFFER_SIZE - used_);
+                std::memset(buffer_ + used_, ch, n);
+                used_ += n;
+                count -= n;
+            }
+        }
+
+        // where the next n bytes go, counted as written and left for the caller to
+        // fill, or nullptr if they don't fit in the buffer
+        char* reserve(size_t n) {
+            if (n > BUFFER_SIZE - used_) {
+                flush();
+                if (n > BUFFER_SIZE) {
+                    return nullptr;
+                }
+            }
+            char* p = buffer_ + used_;
+            used_ += n;
+            written += n;
+            return p;
+        }
+
+        void flush() {
+            if (used_ != 0) {
+                static_cast<Derived*>(this)->sink(buffer_, used_);
+                used_ = 0;
+            }
+        }
+
+        void done() { flush(); }
 
-        std::ostream& os_;
         size_t written = 0;
+
+    private:
+        size_t used_ = 0;
+        char buffer_[BUFFER_SIZE];
     };
 
-    // This context writes to a container using a std::back_inserter
+    // This context writes to a std::ostream
+    struct ostream_writer : staged_writer<ostream_writer> {
+        ostream_writer(std::ostream& os)
+            : os_(os) {}
+
+        ~ostream_writer() { flush(); }
+
+        void sink(const char* p, size_t n) { os_.write(p, n); }
+
+        std::ostream& os_;
+    };
+
+    // This context appends to a container, a whole range at a time so that it grows
+    // once and copies with memcpy
     template <class C> struct container_writer {
         container_writer(C& s)
-            : it_(std::back_inserter(s)) {}
+            : c_(s) {}
 
         void write(char ch) {
-            *it_++ = ch;
+            c_.push_back(ch);
             ++written;
         }
 
         void write(const char* p, size_t n) {
-            while (n--) {
-                write(*p++);
-            }
+            c_.insert(c_.end(), p, p + n);
+            written += n;
+        }
+
+        void write(char ch, size_t count) {
+            c_.insert(c_.end(), count, ch);
+            written += count;
+        }
+
+        // strings and vectors of char grow in place, for the caller to fill
+        template <class D = C>
+        auto reserve(size_t n)
+            -> std::enable_if_t<std::is_same_v<decltype(std::declval<D&>().data()), char*>, char*> {
+            const size_t size = c_.size();
+            c_.resize(size + n);
+            written += n;
+            return c_.data() + size;
         }
 
         void done() noexcept {}
 
-        std::back_insert_iterator<C> it_;
+        C& c_;
         size_t written = 0;
     };
 
     // this context writes to an STDIO stream
-    struct stdio_writer {
+    struct stdio_writer : staged_writer<stdio_writer> {
         stdio_writer(FILE* stream)
             : stream_(stream) {}
 
-        void write(char ch) noexcept {
-            putc(ch, stream_);
-            ++written;
-        }
+        ~stdio_writer() { flush(); }
 
-        void write(const char* p, size_t n) { written += fwrite(p, n, 1, stream_); }
-
-        void done() noexcept {}
+        void sink(const char* p, size_t n) noexcept { fwrite(p, 1, n, stream_); }
 
         FILE* stream_;
-        size_t written = 0;
     };
 
     // this context writes to the stdout stream
-    struct stdout_writer {
-        void write(char ch) noexcept {
-            putchar(ch);
-            ++written;
-        }
-
-        void write(const char* p, size_t n) { written += fwrite(p, n, 1, stdout); }
-
-        void done() noexcept {}
+    struct stdout_writer : staged_writer<stdout_writer> {
+        ~stdout_writer() { flush(); }
 
-        size_t written = 0;
+        void sink(const char* p, size_t n) noexcept { fwrite(p, 1, n, stdout); }
     };
 
+    // whether a context can hand out room in its own buffer, see output_integer
+    template <class Context, class = void> struct has_reserve : std::false_type {};
+    template <class Context>
+    struct has_reserve<Context, std::void_t<decltype(std::declval<Context&>().reserve(size_t()))>>
+        : std::true_type {};
+
 #ifdef __GNUC__
 #define LIKELY(expr) __builtin_expect((expr), 1)
 #define UNLIKELY(expr) __builtin_expect((expr), 0)
@@ -158,357 +274,465 @@ namespace print_detail {
 
     static_assert(sizeof(Flags) == sizeof(uint8_t));
 
-    [[noreturn]] void NO_INLINE ThrowError(const char* what) { throw format_error(what); }
-
-    template <bool Upper, size_t Divisor, class T, size_t N>
-    std::tuple<const char*, size_t> format(char (&buf)[N], T d, int width, Flags flags) noexcept {
-        if constexpr (Divisor == 10) {
-            static constexpr const char digit_pairs[201] = { "00010203040506070809"
-                                                             "10111213141516171819"
-                                                             "20212223242526272829"
-                                                             "30313233343536373839"
-                                                             "40414243444546474849"
-                                                             "50515253545556575859"
-                                                             "60616263646566676869"
-                                                             "70717273747576777879"
-                                                             "80818283848586878889"
-                                                             "90919293949596979899" };
-
-            char* it = &buf[N - 2];
-            if constexpr (std::is_signed<T>::value) {
-                if (d >= 0) {
-                    int div = d / 100;
-                    while (div) {
-                        std::memcpy(it, &digit_pairs[2 * (d - div * 100)], 2);
-                        d = div;
-                        it -= 2;
-                        div = d / 100;
-                    }
-
-                    std::memcpy(it, &digit_pairs[2 * d], 2);
-
-                    if (d < 10) {
-                        it++;
-                    }
-
-                    if (flags.space) {
-                        if (flags.padding) {
-                            while (&buf[N] - it < width - 1) {
-                                *--it = '0';
-                            }
-                        }
-                        *--it = ' ';
-                    } else if (flags.sign) {
-                        if (flags.padding) {
-                            while (&buf[N] - it < width - 1) {
-                                *--it = '0';
-                            }
-                        }
-                        *--it = '+';
-
-                    } else {
-                        if (flags.padding) {
-                            while (&buf[N] - it < width) {
-                                *--it = '0';
-                            }
-                        }
-                    }
-
-                } else {
-                    int div = d / 100;
-                    while (div) {
-                        std::memcpy(it, &digit_pairs[-2 * (d - div * 100)], 2);
-                        d = div;
-                        it -= 2;
-                        div = d / 100;
-                    }
+    // One piece of a format string: literal text when conversion is 0, otherwise a
+    // conversion with everything collected by get_flags ... get_modifier, and the
+    // indices of the arguments it uses. format_to hooks get the conversion they
+    // print for in one of these
+    struct format_spec {
+        size_t offset = 0;
+        size_t length = 0;
+        char conversion = 0;
+        Flags flags = { 0, 0, 0, 0, 0, 0 };
+        long int width = 0;
+        long int precision = -1;
+        Modifiers modifier = Modifiers::MOD_NONE;
+        size_t width_arg = SIZE_MAX;
+        size_t precision_arg = SIZE_MAX;
+        size_t arg = SIZE_MAX;
+    };
 
-                    std::memcpy(it, &digit_pairs[-2 * d], 2);
+    [[noreturn]] inline void NO_INLINE ThrowError(const char* what) { throw format_error(what); }
 
-                    if (d <= -10) {
-                        it--;
-                    }
+    //------------------------------------------------------------------------------
+    // Name: decimal_length
+    // Desc: the number of decimal digits of v, 1 for 0, from the position of its
+    //       highest bit: bits * 1233 / 4096 is log10(2^bits) rounded down, which is
+    //       off by at most one, and a compare with the power of ten settles it
+    //------------------------------------------------------------------------------
+    inline int decimal_length(uint64_t v) noexcept {
+        static constexpr uint64_t powers[20] = { 1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull,
+            1000000ull, 10000000ull, 100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+            1000000000000ull, 10000000000000ull, 100000000000000ull, 1000000000000000ull,
+            10000000000000000ull, 100000000000000000ull, 1000000000000000000ull,
+            10000000000000000000ull };
+        const int bits = 64 - __builtin_clzll(v | 1);
+        const int length = (bits * 1233) >> 12;
+        return length + ((v | 1) >= powers[length]);
+    }
 
-                    if (flags.padding) {
-                        while (&buf[N] - it < width) {
-                            *--it = '0';
-                        }
-                    }
+    // the number of digits of v in base 2^shift, 1 for 0
+    template <int Shift> int power_of_two_length(uint64_t v) noexcept {
+        return (64 - __builtin_clzll(v | 1) + Shift - 1) / Shift;
+    }
 
-                    *it = '-';
-                }
-            } else {
-                if (d >= 0) {
-                    int div = d / 100;
-                    while (div) {
-                        std::memcpy(it, &digit_pairs[2 * (d - div * 100)], 2);
-                        d = div;
-                        it -= 2;
-                        div = d / 100;
-                    }
+    inline constexpr char digit_pairs[201] = { "00010203040506070809"
+                                               "10111213141516171819"
+                                               "20212223242526272829"
+                                               "30313233343536373839"
+                                               "40414243444546474849"
+                                               "50515253545556575859"
+                                               "60616263646566676869"
+                                               "70717273747576777879"
+                                               "80818283848586878889"
+                                               "90919293949596979899" };
+
+    // copies n <= 8 bytes with at most two moves of a fixed size, which unlike a
+    // memcpy of a variable size don't end up as a call into the library
+    inline void copy_short(char* out, const char* p, size_t n) noexcept {
+        if (n >= 4) {
+            std::memcpy(out, p, 4);
+            std::memcpy(out + n - 4, p + n - 4, 4);
+        } else if (n >= 2) {
+            std::memcpy(out, p, 2);
+            std::memcpy(out + n - 2, p + n - 2, 2);
+        } else if (n == 1) {
+            *out = *p;
+        }
+    }
 
-                    std::memcpy(it, &digit_pairs[2 * d], 2);
+    //------------------------------------------------------------------------------
+    // Name: write_eight_digits
+    // Desc: writes v < 10^8 as exactly eight digits. On little endian machines the
+    //       digits are worked out all at once in one 64-bit word, a byte each,
+    //       splitting v in two halves of four digits, each of them in two pairs,
+    //       and each pair in two digits, with multiplications by reciprocals that
+    //       are exact in this range. Elsewhere a pair at a time from a table
+    //------------------------------------------------------------------------------
+    inline void write_eight_digits(char* out, uint32_t v) noexcept {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        const uint64_t halves = (v / 10000) | (uint64_t(v % 10000) << 32);
+        const uint64_t hundreds = ((halves * 10486) >> 20) & 0x0000007f0000007full;
+        const uint64_t pairs = ((halves - 100 * hundreds) << 16) + hundreds;
+        uint64_t tens = ((pairs * 103) >> 10) & 0x000f000f000f000full;
+        tens += (pairs - 10 * tens) << 8;
+        tens += 0x3030303030303030ull;
+        std::memcpy(out, &tens, 8);
+#else
+        for (int i = 6; i >= 0; i -= 2) {
+            std::memcpy(out + i, &digit_pairs[2 * (v % 100)], 2);
+            v /= 100;
+        }
+#endif
+    }
 
-                    if (d < 10) {
-                        it++;
-                    }
+    //------------------------------------------------------------------------------
+    // Name: write_decimal
+    // Desc: writes the length = decimal_length(v) digits of v at out, eight at a
+    //       time from the end, so sixteen for anything below 10^16, and the rest at
+    //       once in place
+    //------------------------------------------------------------------------------
+    inline void write_decimal(char* out, uint64_t v, int length) noexcept {
+        while (length > 8) {
+            const uint64_t q = v / 100000000;
+            length -= 8;
+            write_eight_digits(out + length, uint32_t(v - q * 100000000));
+            v = q;
+        }
 
-                    if (flags.space) {
-                        if (flags.padding) {
-                            while (&buf[N] - it < width - 1) {
-                                *--it = '0';
-                            }
-                        }
-                        *--it = ' ';
-                    } else if (flags.sign) {
-                        if (flags.padding) {
-                            while (&buf[N] - it < width - 1) {
-                                *--it = '0';
-                            }
-                        }
-                        *--it = '+';
+        if (length > 2) {
+            char digits[8];
+            write_eight_digits(digits, uint32_t(v));
+            copy_short(out, digits + 8 - length, length);
+        } else if (length == 2) {
+            std::memcpy(out, &digit_pairs[2 * v], 2);
+        } else {
+            *out = char('0' + v);
+        }
+    }
 
-                    } else {
-                        if (flags.padding) {
-                            while (&buf[N] - it < width) {
-                                *--it = '0';
-                            }
-                        }
-                    }
-                }
+    //------------------------------------------------------------------------------
+    // Name: write_hex
+    // Desc: writes the length = power_of_two_length<4>(v) hex digits of v at out,
+    //       eight at a time: the nibbles of 32 bits are spread one per byte of a
+    //       word, where adding '0' and, to those above 9, the distance to 'a' turns
+    //       them all into digits at once, with no table or branch
+    //------------------------------------------------------------------------------
+    template <bool Upper> void write_hex(char* out, uint64_t v, int length) noexcept {
+        for (;;) {
+            uint64_t x = uint32_t(v);
+            x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+            x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+            x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+            x += 0x3030303030303030ull
+                + (((x + 0x0606060606060606ull) >> 4) & 0x0101010101010101ull) * (Upper ? 7 : 39);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            x = __builtin_bswap64(x);
+#endif
+            if (length <= 8) {
+                copy_short(out, reinterpret_cast<const char*>(&x) + 8 - length, length);
+                return;
             }
+            length -= 8;
+            std::memcpy(out + length, &x, 8);
+            v >>= 32;
+        }
+    }
 
-            return std::make_tuple(it, &buf[N] - it);
-        } else if constexpr (Divisor == 16) {
-            [[maybe_unused]] static constexpr const char xdigit_pairs_l[513]
-                = { "000102030405060708090a0b0c0d0e0f"
-                    "101112131415161718191a1b1c1d1e1f"
-                    "202122232425262728292a2b2c2d2e2f"
-                    "303132333435363738393a3b3c3d3e3f"
-                    "404142434445464748494a4b4c4d4e4f"
-                    "505152535455565758595a5b5c5d5e5f"
-                    "606162636465666768696a6b6c6d6e6f"
-                    "707172737475767778797a7b7c7d7e7f"
-                    "808182838485868788898a8b8c8d8e8f"
-                    "909192939495969798999a9b9c9d9e9f"
-                    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
-                    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
-                    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
-                    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
-                    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
-                    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff" };
-
-            [[maybe_unused]] static constexpr const char xdigit_pairs_u[513]
-                = { "000102030405060708090A0B0C0D0E0F"
-                    "101112131415161718191A1B1C1D1E1F"
-                    "202122232425262728292A2B2C2D2E2F"
-                    "303132333435363738393A3B3C3D3E3F"
-                    "404142434445464748494A4B4C4D4E4F"
-                    "505152535455565758595A5B5C5D5E5F"
-                    "606162636465666768696A6B6C6D6E6F"
-                    "707172737475767778797A7B7C7D7E7F"
-                    "808182838485868788898A8B8C8D8E8F"
-                    "909192939495969798999A9B9C9D9E9F"
-                    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
-                    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
-                    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
-                    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
-                    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
-                    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF" };
-
-            // NOTE(eteran): we include the x/X, here as an easy way to put the
-            //               upper/lower case prefix for hex numbers
-            [[maybe_unused]] static constexpr const char alphabet_l[] = "0123456789abcdefx";
-            [[maybe_unused]] static constexpr const char alphabet_u[] = "0123456789ABCDEFX";
-
-            typename std::make_unsigned<T>::type ud = d;
-
-            char* p = buf + N;
-
-            if (ud >= 0) {
-                while (ud > 16) {
-                    p -= 2;
-                    if constexpr (Upper) {
-                        std::memcpy(p, &xdigit_pairs_u[2 * (ud & 0xff)], 2);
-                    } else {
-                        std::memcpy(p, &xdigit_pairs_l[2 * (ud & 0xff)], 2);
-                    }
-                    ud /= 256;
-                }
+    //------------------------------------------------------------------------------
+    // Name: write_binary
+    // Desc: writes the length = power_of_two_length<1>(v) binary digits of v at out,
+    //       a byte at a time: copies of it in every byte of a word, each masked with
+    //       its own bit, are 0 or not, and adding 0x7f moves that into the top bit
+    //------------------------------------------------------------------------------
+    inline void write_binary(char* out, uint64_t v, int length) noexcept {
+        for (;;) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            constexpr uint64_t mask = 0x0102040810204080ull;
+#else
+            constexpr uint64_t mask = 0x8040201008040201ull;
+#endif
+            uint64_t x = ((v & 0xff) * 0x0101010101010101ull) & mask;
+            x = ((x + 0x7f7f7f7f7f7f7f7full) >> 7) & 0x0101010101010101ull;
+            x += 0x3030303030303030ull;
+            if (length <= 8) {
+                copy_short(out, reinterpret_cast<const char*>(&x) + 8 - length, length);
+                return;
+            }
+            length -= 8;
+            std::memcpy(out + length, &x, 8);
+            v >>= 8;
+        }
+    }
 
-                while (ud > 0) {
-                    p -= 1;
-                    if constexpr (Upper) {
-                        std::memcpy(p, &xdigit_pairs_u[2 * (ud & 0x0f) + 1], 1);
-                    } else {
-                        std::memcpy(p, &xdigit_pairs_l[2 * (ud & 0x0f) + 1], 1);
-                    }
-                    ud /= 16;
-                }
+    // writes the length = power_of_two_length<3>(v) octal digits of v at out
+    inline void write_octal(char* out, uint64_t v, int length) noexcept {
+        while (length > 0) {
+            out[--length] = char('0' + (v & 7));
+            v >>= 3;
+        }
+    }
 
-                // add in any necessary padding
-                if (flags.padding) {
-                    while (&buf[N] - p < width) {
-                        *--p = '0';
-                    }
-                }
+    //------------------------------------------------------------------------------
+    // Name: output_string
+    // Desc: prints a string to the Context object, taking into account padding flags
+    // Note: ch is the current format specifier
+    //------------------------------------------------------------------------------
+    template <class Context>
+    void output_string(char ch, const char* s_ptr, int precision, long int width, Flags flags,
+        int len, Context& ctx) {
+        if ((ch == 's' && precision >= 0 && precision < len)) {
+            len = precision;
+        }
 
-                // add the prefix as needed
-                if (flags.prefix) {
-                    if constexpr (Upper) {
-                        *--p = alphabet_u[16];
-                    } else {
-                        *--p = alphabet_l[16];
-                    }
-                    *--p = '0';
-                }
-            }
+        const size_t padding = width > len ? width - len : 0;
 
-            return std::make_tuple(p, (buf + N) - p);
-        } else if constexpr (Divisor == 8) {
-            static constexpr const char digit_pairs[129] = { "0001020304050607"
-                                                             "1011121314151617"
-                                                             "2021222324252627"
-                                                             "3031323334353637"
-                                                             "4041424344454647"
-                                                             "5051525354555657"
-                                                             "6061626364656667"
-                                                             "7071727374757677" };
-            typename std::make_unsigned<T>::type ud = d;
-
-            char* p = buf + N;
-
-            if (ud >= 0) {
-                while (ud > 64) {
-                    p -= 2;
-                    std::memcpy(p, &digit_pairs[2 * (ud & 077)], 2);
-                    ud /= 64;
-                }
+        // if not left justified padding goes first...
+        if (!flags.justify) {
+            // spaces go before the prefix...
+            ctx.write(' ', padding);
+        }
 
-                while (ud > 0) {
-                    p -= 1;
-                    std::memcpy(p, &digit_pairs[2 * (ud & 007) + 1], 1);
-                    ud /= 8;
-                }
+        // output the string
+        // NOTE(eteran): len is at most strlen, possible is less
+        ctx.write(s_ptr, len);
 
-                // add in any necessary padding
-                if (flags.padding) {
-                    while (&buf[N] - p < width) {
-                        *--p = '0';
-                    }
-                }
+        // if left justified padding goes last...
+        if (flags.justify) {
+            ctx.write(' ', padding);
+        }
+    }
 
-                // add the prefix as needed
-                if (flags.prefix) {
-                    *--p = '0';
-                }
+    //------------------------------------------------------------------------------
+    // Name: output_integer
+    // Desc: prints an integer for the conversion C, one of d, u, x, X, o, b and p,
+    //       to the Context object with the C rules for flags, width and precision.
+    //       The digits are counted first, so that sign, prefix, zeros and digits
+    //       are each written once where they go: in the Context's own buffer when
+    //       it has room for them, or in one on the stack handed over at once
+    //------------------------------------------------------------------------------
+    template <char C, class Context, class T>
+    void output_integer(T d, long int precision, long int width, Flags flags, Context& ctx) {
+        char head[4]; // 3 used, the 4th keeps -Warray-bounds quiet about copy_short's 4-byte path
+        size_t head_len = 0;
+
+        uint64_t v = static_cast<uint64_t>(d);
+        if constexpr (std::is_signed_v<T>) {
+            if (d < 0) {
+                v = 0 - v;
+                head[head_len++] = '-';
+            } else if (flags.sign) {
+                head[head_len++] = '+';
+            } else if (flags.space) {
+                head[head_len++] = ' ';
             }
-
-            return std::make_tuple(p, (buf + N) - p);
         }
-        if constexpr (Divisor == 2) {
-            static constexpr const char digit_pairs[9] = { "00011011" };
 
-            typename std::make_unsigned<T>::type ud = d;
-
-            char* p = buf + N;
+        int length;
+        if constexpr (C == 'x' || C == 'X' || C == 'p') {
+            length = power_of_two_length<4>(v);
+            if (C == 'p' || (flags.prefix && v != 0)) {
+                head[head_len++] = '0';
+                head[head_len++] = C == 'X' ? 'X' : 'x';
+            }
+        } else if constexpr (C == 'b') {
+            length = power_of_two_length<1>(v);
+            if (flags.prefix && v != 0) {
+                head[head_len++] = '0';
+                head[head_len++] = 'b';
+            }
+        } else if constexpr (C == 'o') {
+            length = power_of_two_length<3>(v);
+        } else {
+            length = decimal_length(v);
+        }
 
-            if (ud >= 0) {
-                while (ud > 4) {
-                    p -= 2;
-                    std::memcpy(p, &digit_pairs[2 * (ud & 0x03)], 2);
-                    ud /= 4;
-                }
+        // a precision is the least number of digits, and 0 prints nothing for 0
+        if (precision == 0 && v == 0) {
+            length = 0;
+        }
+        size_t zeros = precision > length ? precision - length : 0;
+        if (flags.padding && !flags.justify && precision < 0 && width > long(head_len + length)) {
+            zeros = width - head_len - length;
+        }
+        if (C == 'o' && flags.prefix && zeros == 0 && (v != 0 || length == 0)) {
+            // # makes the first octal digit a 0
+            zeros = 1;
+        }
 
-                while (ud > 0) {
-                    p -= 1;
-                    std::memcpy(p, &digit_pairs[2 * (ud & 0x01) + 1], 1);
-                    ud /= 2;
-                }
+        const size_t len = head_len + zeros + length;
+        const size_t padding = width > long(len) ? width - len : 0;
 
-                // add in any necessary padding
-                if (flags.padding) {
-                    while (&buf[N] - p < width) {
-                        *--p = '0';
-                    }
-                }
+        if (padding != 0 && !flags.justify) {
+            ctx.write(' ', padding);
+        }
 
-                // add the prefix as needed
-                if (flags.prefix) {
-                    *--p = '0';
-                }
+        auto fill = [&](char* p) {
+            copy_short(p, head, head_len);
+            p += head_len;
+            if (zeros != 0) {
+                std::memset(p, '0', zeros);
+                p += zeros;
+            }
+            if constexpr (C == 'x' || C == 'X' || C == 'p') {
+                write_hex<C == 'X'>(p, v, length);
+            } else if constexpr (C == 'b') {
+                write_binary(p, v, length);
+            } else if constexpr (C == 'o') {
+                write_octal(p, v, length);
+            } else if (length != 0) {
+                write_decimal(p, v, length);
             }
+        };
 
-            return std::make_tuple(p, (buf + N) - p);
+        char* out = nullptr;
+        if constexpr (has_reserve<Context>::value) {
+            out = ctx.reserve(len);
+        }
+        if (LIKELY(out != nullptr)) {
+            fill(out);
+        } else if (len <= 96) {
+            char buf[96];
+            fill(buf);
+            ctx.write(buf, len);
+        } else {
+            // zeros to a large width
+            ctx.write(head, head_len);
+            ctx.write('0', zeros);
+            head_len = zeros = 0;
+            char buf[64];
+            fill(buf);
+            ctx.write(buf, length);
         }
 
-        ThrowError("Invalid Base Used In Integer To String Conversion");
-    }
-
-    //------------------------------------------------------------------------------
-    // Name: itoa
-    // Desc: as a minor optimization, let's determine a few things up front and pass
-    //       them as template parameters enabling some more aggressive optimizations
-    //       when the division can use more efficient operations
-    //------------------------------------------------------------------------------
-    template <class T, size_t N>
-    std::tuple<const char*, size_t> itoa(
-        char (&buf)[N], char base, int precision, T d, int width, Flags flags) noexcept {
-        if (d == 0 && precision == 0) {
-            *buf = '\0';
-            return std::make_tuple(buf, 0);
+        if (padding != 0 && flags.justify) {
+            ctx.write(' ', padding);
         }
+    }
 
-        switch (base) {
-        case 'i':
-        case 'd':
-        case 'u':
-            return format<false, 10>(buf, d, width, flags);
-        case 'b':
-            return format<false, 2>(buf, d, width, flags);
-        case 'X':
-            return format<true, 16>(buf, d, width, flags);
+    template <class Context, class T>
+    void output_integer(
+        char ch, T d, long int precision, long int width, Flags flags, Context& ctx) {
+        switch (ch) {
         case 'x':
-            return format<false, 16>(buf, d, width, flags);
+            return output_integer<'x'>(d, precision, width, flags, ctx);
+        case 'X':
+            return output_integer<'X'>(d, precision, width, flags, ctx);
         case 'o':
-            return format<false, 8>(buf, d, width, flags);
+            return output_integer<'o'>(d, precision, width, flags, ctx);
+        case 'b':
+            return output_integer<'b'>(d, precision, width, flags, ctx);
+        case 'p':
+            return output_integer<'p'>(d, precision, width, flags, ctx);
         default:
-            return format<false, 10>(buf, d, width, flags);
+            return output_integer<'d'>(d, precision, width, flags, ctx);
         }
     }
 
     //------------------------------------------------------------------------------
-    // Name: output_string
-    // Desc: prints a string to the Context object, taking into account padding flags
-    // Note: ch is the current format specifier
+    // Name: output_float
+    // Desc: prints a double for %f, %e, %g and %a (and their upper case versions)
+    //       to the Context object, with exact digits rounded half to even, taking
+    //       into account the flags, width and precision
     //------------------------------------------------------------------------------
     template <class Context>
-    void output_string(char ch, const char* s_ptr, int precision, long int width, Flags flags,
-        int len, Context& ctx) {
-        if ((ch == 's' && precision >= 0 && precision < len)) {
-            len = precision;
+    void output_float(char ch, double v, long int precision, long int width, Flags flags, Context& ctx) {
+        const bool upper = ch >= 'A' && ch <= 'Z';
+        const char conversion = upper ? ch - 'A' + 'a' : ch;
+
+        char prefix[3];
+        size_t prefix_len = 0;
+        if (std::signbit(v)) {
+            prefix[prefix_len++] = '-';
+        } else if (flags.sign) {
+            prefix[prefix_len++] = '+';
+        } else if (flags.space) {
+            prefix[prefix_len++] = ' ';
         }
 
-        // if not left justified padding goes first...
-        if (!flags.justify) {
-            // spaces go before the prefix...
-            while (width-- > len) {
-                ctx.write(' ');
+        // the number is int_part[.frac_part<frac_zeros zeros>]suffix
+        char digits[detail::MAX_FLOAT_DIGITS];
+        const char* int_part = digits;
+        size_t int_len = 0;
+        const char* frac_part = nullptr;
+        size_t frac_len = 0;
+        size_t frac_zeros = 0;
+        bool point = false;
+        char suffix[8];
+        size_t suffix_len = 0;
+
+        auto exponent_suffix = [&](char e, int exponent, int min_digits) {
+            suffix[suffix_len++] = upper ? e - 'a' + 'A' : e;
+            suffix[suffix_len++] = exponent < 0 ? '-' : '+';
+            const unsigned int magnitude = exponent < 0 ? -exponent : exponent;
+            const int length = std::max(min_digits, detail::decimalLength(magnitude));
+            detail::writeDigits(suffix + suffix_len, magnitude, length);
+            suffix_len += length;
+        };
+
+        auto fixed = [&](int fraction_digits) {
+            int zeros;
+            const int count = detail::formatFixedDigits(v, fraction_digits, digits, zeros);
+            int_len = count + zeros - fraction_digits;
+            frac_part = digits + int_len;
+            frac_len = count - int_len;
+            frac_zeros = zeros;
+        };
+
+        auto scientific = [&](int significant_digits) {
+            int zeros, exponent;
+            const int count = detail::formatScientificDigits(v, significant_digits, digits, zeros, exponent);
+            int_len = 1;
+            frac_part = digits + 1;
+            frac_len = count - 1;
+            frac_zeros = zeros;
+            return exponent;
+        };
+
+        if (!std::isfinite(v)) {
+            if (std::isnan(v)) {
+                int_part = upper ? "NAN" : "nan";
+            } else {
+                int_part = upper ? "INF" : "inf";
+            }
+            int_len = 3;
+            // infinities and NaNs are never zero padded
+            flags.padding = 0;
+        } else if (conversion == 'f') {
+            fixed(precision < 0 ? 6 : precision);
+        } else if (conversion == 'e') {
+            const int exponent = scientific((precision < 0 ? 6 : precision) + 1);
+            exponent_suffix('e', exponent, 2);
+        } else if (conversion == 'g') {
+            const int p = precision < 0 ? 6 : precision == 0 ? 1 : precision;
+            const int exponent = scientific(p);
+            if (exponent < p && exponent >= -4) {
+                fixed(p - 1 - exponent);
+            } else {
+                exponent_suffix('e', exponent, 2);
+            }
+            if (!flags.prefix) {
+                // %g drops trailing zeros, unless the alternate form is asked for
+                frac_zeros = 0;
+                while (frac_len > 0 && frac_part[frac_len - 1] == '0') {
+                    --frac_len;
+                }
             }
+        } else {
+            prefix[prefix_len++] = '0';
+            prefix[prefix_len++] = upper ? 'X' : 'x';
+            int exponent;
+            frac_len = detail::formatHexDigits(v, precision, upper, digits, exponent);
+            int_len = 1;
+            frac_part = digits + 1;
+            frac_zeros = precision > static_cast<long int>(frac_len) ? precision - frac_len : 0;
+            exponent_suffix('p', exponent, 1);
         }
+        point = frac_len + frac_zeros > 0 || (flags.prefix && std::isfinite(v));
 
-        // output the string
-        // NOTE(eteran): len is at most strlen, possible is less
-        // so we can just loop len times
-        width -= len;
+        const long int len = prefix_len + int_len + point + frac_len + frac_zeros + suffix_len;
 
-        ctx.write(s_ptr, len);
+        const size_t padding = width > len ? width - len : 0;
+
+        if (!flags.justify && !flags.padding) {
+            ctx.write(' ', padding);
+        }
+
+        ctx.write(prefix, prefix_len);
+
+        if (!flags.justify && flags.padding) {
+            ctx.write('0', padding);
+        }
+
+        ctx.write(int_part, int_len);
+        if (point) {
+            ctx.write('.');
+        }
+        ctx.write(frac_part, frac_len);
+        ctx.write('0', frac_zeros);
+        ctx.write(suffix, suffix_len);
 
-        // if left justified padding goes last...
         if (flags.justify) {
-            while (width-- > 0) {
-                ctx.write(' ');
-            }
+            ctx.write(' ', padding);
         }
     }
 
@@ -531,6 +755,13 @@ namespace print_detail {
         ThrowError("Non-String Argument For String Format");
     }
 
+    template <class T> constexpr double formatted_float([[maybe_unused]] T n) {
+        if constexpr (std::is_floating_point<T>::value) {
+            return static_cast<double>(n);
+        }
+        ThrowError("Non-Float Argument For Float Format");
+    }
+
     template <class R, class T> constexpr R formatted_pointer([[maybe_unused]] T p) {
         if constexpr (std::is_convertible<T, const void*>::value) {
             return reinterpret_cast<R>(reinterpret_cast<uintptr_t>(p));
@@ -545,22 +776,155 @@ namespace print_detail {
         ThrowError("Non-Integer Argument For Integer Format");
     }
 
+    // This context only counts what is written to it
+    struct counting_writer {
+        void write(char) noexcept { ++written; }
+        void write(const char*, size_t n) noexcept { written += n; }
+        void write(char, size_t count) noexcept { written += count; }
+        void done() noexcept {}
+
+        size_t written = 0;
+    };
+
+    // This context passes on at most limit bytes to the one it wraps, for a
+    // precision on something written piece by piece
+    template <class Context> struct limit_writer {
+        limit_writer(Context& ctx, size_t limit)
+            : ctx_(ctx)
+            , limit_(limit) {}
+
+        void write(char ch) {
+            if (written++ < limit_) {
+                ctx_.write(ch);
+            }
+        }
+
+        void write(const char* p, size_t n) {
+            if (written < limit_) {
+                ctx_.write(p, std::min(n, limit_ - written));
+            }
+            written += n;
+        }
+
+        void write(char ch, size_t count) {
+            if (written < limit_) {
+                ctx_.write(ch, std::min(count, limit_ - written));
+            }
+            written += count;
+        }
+
+        void done() noexcept {}
+
+        Context& ctx_;
+        size_t limit_;
+        size_t written = 0;
+    };
+
     //------------------------------------------------------------------------------
-    // Name: process_format
-    // Desc: prints the next argument to the Context taking into account the flags,
-    //       width, precision, and modifiers collected along the way. Then will
-    //       recursively continue processing the string
+    // Name: format_to
+    // Desc: the customization point of %$ and %?. An overload of
+    //           template <class Context>
+    //           void format_to(Context& ctx, const T& obj, const format_spec& spec);
+    //       found by argument dependent lookup next to T writes obj straight to ctx,
+    //       with ctx.write or Printf(ctx, ...), and without a std::string in
+    //       between. The width and precision of spec are applied around what it
+    //       writes, as for %s, so it has to work with any Context. Types without
+    //       one are printed with to_string. These are the ones for the standard
+    //       library: strings, ranges (maps as {k: v}), pairs and tuples, and
+    //       chrono durations with their unit; %#$ prints nested ranges as a tree
     //------------------------------------------------------------------------------
-    template <class Context, class T, class... Ts>
-    int process_format(Context& ctx, const char* format, Flags flags, long int width,
-        long int precision, Modifiers modifier, const T& arg, const Ts&... ts) {
-        // enough to contain a 64-bit number in bin notation + optional prefix
-        char num_buf[67];
+    template <class T, class = void> struct is_range : std::false_type {};
+    template <class T>
+    struct is_range<T,
+        std::void_t<decltype(std::begin(std::declval<const T&>())),
+            decltype(std::end(std::declval<const T&>()))>>
+        : std::bool_constant<!std::is_convertible_v<const T&, std::string_view>> {};
+
+    template <class T> using enable_if_range = std::enable_if_t<is_range<T>::value, int>;
+
+    template <class Context> void format_to(Context& ctx, std::string_view s, const format_spec&);
+    template <class Context>
+    void format_to(Context& ctx, const std::string& s, const format_spec& spec);
+    template <class Context, class Rep, class Period>
+    void format_to(Context& ctx, const std::chrono::duration<Rep, Period>& d, const format_spec&);
+    template <class Context, class T, class U>
+    void format_to(Context& ctx, const std::pair<T, U>& p, const format_spec& spec);
+    template <class Context, class... Ts>
+    void format_to(Context& ctx, const std::tuple<Ts...>& t, const format_spec& spec);
+    template <class Context, class R, enable_if_range<R> = 0>
+    void format_to(Context& ctx, const R& range, const format_spec& spec);
+
+    template <class Context, class T, class = void> struct has_format_to : std::false_type {};
+    template <class Context, class T>
+    struct has_format_to<Context, T,
+        std::void_t<decltype(format_to(std::declval<Context&>(), std::declval<const T&>(),
+            std::declval<const format_spec&>()))>> : std::true_type {};
+
+    template <class Context, class T>
+    void format_object(Context& ctx, const T& obj, const format_spec& spec) {
+        if constexpr (has_format_to<Context, T>::value) {
+            format_to(ctx, obj, spec);
+        } else {
+            const std::string s = formatted_object(obj);
+            ctx.write(s.data(), s.size());
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Name: output_object
+    // Desc: prints an object for %$ and %? to the Context object, through its
+    //       format_to. Left justified or without a width it is written once; a
+    //       width on the right counts its length with a first pass that writes
+    //       nothing
+    //------------------------------------------------------------------------------
+    template <class Context, class T>
+    void output_object(const T& obj, const format_spec& spec, Context& ctx) {
+        if constexpr (!has_format_to<Context, T>::value) {
+            const std::string s = formatted_object(obj);
+            output_string(
+                's', s.data(), spec.precision, spec.width, spec.flags, int(s.size()), ctx);
+        } else if (spec.precision < 0 && (spec.width <= 0 || spec.flags.justify)) {
+            const size_t start = ctx.written;
+            format_to(ctx, obj, spec);
+            const size_t len = ctx.written - start;
+            if (spec.width > long(len)) {
+                ctx.write(' ', spec.width - len);
+            }
+        } else {
+            size_t len = spec.precision < 0 ? SIZE_MAX : size_t(spec.precision);
+            if (spec.width > 0) {
+                counting_writer counter;
+                format_object(counter, obj, spec);
+                len = std::min(len, counter.written);
+            }
+            const size_t padding = spec.width > long(len) ? spec.width - len : 0;
+            if (!spec.flags.justify) {
+                ctx.write(' ', padding);
+            }
+            limit_writer<Context> limited(ctx, len);
+            format_object(limited, obj, spec);
+            if (spec.flags.justify) {
+                ctx.write(' ', padding);
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Name: format_arg
+    // Desc: prints one argument to the Context for the conversion specifier ch,
+    //       taking into account the flags, width, precision, and modifiers.
+    //       Returns false if the specifier doesn't take an argument (%% and
+    //       unknown ones, which are printed as they are)
+    //------------------------------------------------------------------------------
+    template <class Context, class T>
+    bool format_arg(Context& ctx, char ch, Flags flags, long int width, long int precision,
+        Modifiers modifier, const T& arg) {
+        // enough for the shortest digits of a double
+        char num_buf[32];
 
         size_t slen;
         const char* s_ptr;
 
-        char ch = *format;
         switch (ch) {
         case 'e':
         case 'E':
@@ -570,109 +934,84 @@ namespace print_detail {
         case 'A':
         case 'g':
         case 'G':
-            // TODO(eteran): implement float formatting... for now, just consume the argument
-            return Printf(ctx, format + 1, ts...);
+            output_float(ch, formatted_float(arg), precision, width, flags, ctx);
+            return true;
 
         case 'p':
-            precision = 1;
-            ch = 'x';
-            flags.prefix = 1;
             // NOTE(eteran): GNU printf prints "(nil)" for NULL pointers, we print 0x0
-            std::tie(s_ptr, slen)
-                = itoa(num_buf, ch, precision, formatted_pointer<uintptr_t>(arg), width, flags);
-
-            output_string(ch, s_ptr, precision, width, flags, slen, ctx);
-            return Printf(ctx, format + 1, ts...);
+            output_integer<'p'>(formatted_pointer<uintptr_t>(arg), precision, width, flags, ctx);
+            return true;
         case 'x':
         case 'X':
         case 'u':
         case 'o':
         case 'b': // extension, BINARY mode
-            if (precision < 0) {
-                precision = 1;
-            }
-
             switch (modifier) {
             case Modifiers::MOD_CHAR:
-                std::tie(s_ptr, slen) = itoa(
-                    num_buf, ch, precision, formatted_integer<unsigned char>(arg), width, flags);
+                output_integer(
+                    ch, formatted_integer<unsigned char>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_SHORT:
-                std::tie(s_ptr, slen) = itoa(num_buf, ch, precision,
-                    formatted_integer<unsigned short int>(arg), width, flags);
+                output_integer(
+                    ch, formatted_integer<unsigned short int>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_LONG:
-                std::tie(s_ptr, slen) = itoa(num_buf, ch, precision,
-                    formatted_integer<unsigned long int>(arg), width, flags);
+                output_integer(
+                    ch, formatted_integer<unsigned long int>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_LONG_LONG:
-                std::tie(s_ptr, slen) = itoa(num_buf, ch, precision,
-                    formatted_integer<unsigned long long int>(arg), width, flags);
+                output_integer(ch, formatted_integer<unsigned long long int>(arg), precision, width,
+                    flags, ctx);
                 break;
             case Modifiers::MOD_INTMAX_T:
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_integer<uintmax_t>(arg), width, flags);
+                output_integer(ch, formatted_integer<uintmax_t>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_SIZE_T:
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_integer<size_t>(arg), width, flags);
+                output_integer(ch, formatted_integer<size_t>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_PTRDIFF_T:
-                std::tie(s_ptr, slen) = itoa(num_buf, ch, precision,
-                    formatted_integer<std::make_unsigned<ptrdiff_t>::type>(arg), width, flags);
+                output_integer(ch, formatted_integer<std::make_unsigned<ptrdiff_t>::type>(arg),
+                    precision, width, flags, ctx);
                 break;
             default:
-                std::tie(s_ptr, slen) = itoa(
-                    num_buf, ch, precision, formatted_integer<unsigned int>(arg), width, flags);
+                output_integer(
+                    ch, formatted_integer<unsigned int>(arg), precision, width, flags, ctx);
                 break;
             }
-
-            output_string(ch, s_ptr, precision, width, flags, slen, ctx);
-            return Printf(ctx, format + 1, ts...);
+            return true;
 
         case 'i':
         case 'd':
-            if (precision < 0) {
-                precision = 1;
-            }
-
             switch (modifier) {
             case Modifiers::MOD_CHAR:
-                std::tie(s_ptr, slen) = itoa(
-                    num_buf, ch, precision, formatted_integer<signed char>(arg), width, flags);
+                output_integer(
+                    ch, formatted_integer<signed char>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_SHORT:
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_integer<short int>(arg), width, flags);
+                output_integer(ch, formatted_integer<short int>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_LONG:
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_integer<long int>(arg), width, flags);
+                output_integer(ch, formatted_integer<long int>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_LONG_LONG:
-                std::tie(s_ptr, slen) = itoa(
-                    num_buf, ch, precision, formatted_integer<long long int>(arg), width, flags);
+                output_integer(
+                    ch, formatted_integer<long long int>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_INTMAX_T:
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_integer<intmax_t>(arg), width, flags);
+                output_integer(ch, formatted_integer<intmax_t>(arg), precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_SIZE_T:
-                std::tie(s_ptr, slen) = itoa(num_buf, ch, precision,
-                    formatted_integer<std::make_signed<size_t>::type>(arg), width, flags);
+                output_integer(ch, formatted_integer<std::make_signed<size_t>::type>(arg),
+                    precision, width, flags, ctx);
                 break;
             case Modifiers::MOD_PTRDIFF_T:
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_integer<ptrdiff_t>(arg), width, flags);
+                output_integer(ch, formatted_integer<ptrdiff_t>(arg), precision, width, flags, ctx);
                 break;
             default:
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_integer<int>(arg), width, flags);
+                output_integer(ch, formatted_integer<int>(arg), precision, width, flags, ctx);
                 break;
             }
-
-            output_string(ch, s_ptr, precision, width, flags, slen, ctx);
-            return Printf(ctx, format + 1, ts...);
+            return true;
 
         case 'c':
             // char is promoted to an int when pushed on the stack
@@ -680,7 +1019,7 @@ namespace print_detail {
             num_buf[1] = '\0';
             s_ptr = num_buf;
             output_string('c', s_ptr, precision, width, flags, 1, ctx);
-            return Printf(ctx, format + 1, ts...);
+            return true;
 
         case 's':
             s_ptr = formatted_string(arg);
@@ -688,7 +1027,7 @@ namespace print_detail {
                 s_ptr = "(null)";
             }
             output_string('s', s_ptr, precision, width, flags, strlen(s_ptr), ctx);
-            return Printf(ctx, format + 1, ts...);
+            return true;
 
         case '?':
         case '$':
@@ -698,44 +1037,36 @@ namespace print_detail {
                 num_buf[1] = '\0';
                 s_ptr = num_buf;
                 output_string('c', s_ptr, precision, width, flags, 1, ctx);
-                return Printf(ctx, format + 1, ts...);
+                return true;
             } else if constexpr (std::is_same_v<Arg, char*> || std::is_same_v<Arg, const char*>) {
                 s_ptr = formatted_string(arg);
                 if (!s_ptr) {
                     s_ptr = "(null)";
                 }
                 output_string('s', s_ptr, precision, width, flags, strlen(s_ptr), ctx);
-                return Printf(ctx, format + 1, ts...);
+                return true;
             } else if constexpr (std::is_pointer_v<Arg>) {
-                precision = 1;
-                ch = 'x';
-                flags.prefix = 1;
-                // NOTE(eteran): GNU printf prints "(nil)" for NULL pointers, we print 0x0
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_pointer<uintptr_t>(arg), width, flags);
-                output_string(ch, s_ptr, precision, width, flags, slen, ctx);
-                return Printf(ctx, format + 1, ts...);
+                output_integer<'p'>(
+                    formatted_pointer<uintptr_t>(arg), precision, width, flags, ctx);
+                return true;
             } else if constexpr (std::is_integral_v<Arg>) {
-                std::tie(s_ptr, slen)
-                    = itoa(num_buf, ch, precision, formatted_integer<Arg>(arg), width, flags);
-                output_string(ch, s_ptr, precision, width, flags, slen, ctx);
-                return Printf(ctx, format + 1, ts...);
+                output_integer<'d'>(formatted_integer<Arg>(arg), precision, width, flags, ctx);
+                return true;
             } else if constexpr (std::is_floating_point_v<Arg>) {
-                std::string s = formatted_object(arg);
-                auto i = s.size();
-                for (; i--;) {
-                    if (s[i] != '0')
-                        break;
-                }
-                if (i == 0 || s[i] == '.')
-                    i++;
-                i++;
-                output_string('s', s.data(), precision, width, flags, i, ctx);
-                return Printf(ctx, format + 1, ts...);
+                // the shortest digits that read back as the same value
+                using Shortest = std::conditional_t<std::is_same_v<Arg, float>, float, double>;
+                slen = formatShortest(num_buf, static_cast<Shortest>(arg));
+                output_string('s', num_buf, precision, width, flags, slen, ctx);
+                return true;
             } else {
-                std::string s = formatted_object(arg);
-                output_string('s', s.data(), precision, width, flags, s.size(), ctx);
-                return Printf(ctx, format + 1, ts...);
+                format_spec spec;
+                spec.conversion = ch;
+                spec.flags = flags;
+                spec.width = width;
+                spec.precision = precision;
+                spec.modifier = modifier;
+                output_object(arg, spec, ctx);
+                return true;
             }
 
         case 'n':
@@ -766,18 +1097,178 @@ namespace print_detail {
                 break;
             }
 
-            return Printf(ctx, format + 1, ts...);
+            return true;
 
         default:
             ctx.write('%');
             [[fallthrough]];
-        case '\0':
         case '%':
             ctx.write(ch);
-            break;
+            return false;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Name: format_to
+    // Desc: the overloads for the standard library, declared above
+    //------------------------------------------------------------------------------
+    template <class Context> void format_to(Context& ctx, std::string_view s, const format_spec&) {
+        ctx.write(s.data(), s.size());
+    }
+
+    template <class Context>
+    void format_to(Context& ctx, const std::string& s, const format_spec& spec) {
+        format_to(ctx, std::string_view(s), spec);
+    }
+
+    // an element of a range, pair or tuple, as %$ prints it alone
+    template <class Context, class T> void format_element(Context& ctx, const T& v) {
+        format_arg(ctx, '$', Flags {}, 0, -1, Modifiers::MOD_NONE, v);
+    }
+
+    template <class Context, class Rep, class Period>
+    void format_to(Context& ctx, const std::chrono::duration<Rep, Period>& d, const format_spec&) {
+        format_element(ctx, d.count());
+        if constexpr (std::is_same_v<Period, std::nano>) {
+            ctx.write("ns", 2);
+        } else if constexpr (std::is_same_v<Period, std::micro>) {
+            ctx.write("us", 2);
+        } else if constexpr (std::is_same_v<Period, std::milli>) {
+            ctx.write("ms", 2);
+        } else if constexpr (std::is_same_v<Period, std::ratio<1>>) {
+            ctx.write('s');
+        } else if constexpr (std::is_same_v<Period, std::ratio<60>>) {
+            ctx.write("min", 3);
+        } else if constexpr (std::is_same_v<Period, std::ratio<3600>>) {
+            ctx.write('h');
+        } else if constexpr (std::is_same_v<Period, std::ratio<86400>>) {
+            ctx.write('d');
+        } else {
+            // as std::format: [num/den]s, or [num]s
+            ctx.write('[');
+            output_integer<'d'>(intmax_t(Period::num), -1, 0, Flags {}, ctx);
+            if constexpr (Period::den != 1) {
+                ctx.write('/');
+                output_integer<'d'>(intmax_t(Period::den), -1, 0, Flags {}, ctx);
+            }
+            ctx.write("]s", 2);
+        }
+    }
+
+    template <class Context, class T, class U>
+    void format_to(Context& ctx, const std::pair<T, U>& p, const format_spec&) {
+        ctx.write('(');
+        format_element(ctx, p.first);
+        ctx.write(", ", 2);
+        format_element(ctx, p.second);
+        ctx.write(')');
+    }
+
+    template <class Context, class... Ts>
+    void format_to(Context& ctx, const std::tuple<Ts...>& t, const format_spec&) {
+        ctx.write('(');
+        std::apply(
+            [&](const auto&... vs) {
+                size_t i = 0;
+                ((ctx.write(", ", i++ ? 2 : 0), format_element(ctx, vs)), ...);
+            },
+            t);
+        ctx.write(')');
+    }
+
+    template <class T, class = void> struct is_map : std::false_type {};
+    template <class T> struct is_map<T, std::void_t<typename T::mapped_type>> : std::true_type {};
+
+    // The trunk of a node of a tree printed with %#$, on the stack of the call
+    // printing it, in the layout of dump.hpp: each level is 4 columns, with a
+    // branch to the node itself and a vertical line for ancestors with more
+    // children to come
+    struct tree_trunk {
+        const tree_trunk* prev;
+        bool last;
+    };
+
+    template <class Context> void write_trunk(Context& ctx, const tree_trunk* trunk, bool own) {
+        if (trunk->prev) {
+            write_trunk(ctx, trunk->prev, false);
+        }
+        if (own) {
+            ctx.write(trunk->last ? "`---" : "|---", 4);
+        } else {
+            ctx.write(trunk->last ? "    " : "|   ", 4);
+        }
+    }
+
+    // writes a node: what %$ would print for it, or for a range its size, and
+    // then its elements on the lines below, map entries as key: value
+    template <class Context, class T>
+    void format_tree(Context& ctx, const T& v, const tree_trunk* trunk) {
+        if constexpr (is_range<T>::value) {
+            const auto end = std::end(v);
+            ctx.write(is_map<T>::value ? '{' : '[');
+            output_integer<'d'>(std::distance(std::begin(v), end), -1, 0, Flags {}, ctx);
+            ctx.write(is_map<T>::value ? '}' : ']');
+            for (auto it = std::begin(v); it != end;) {
+                const auto& element = *it;
+                const tree_trunk child { trunk, ++it == end };
+                ctx.write('\n');
+                write_trunk(ctx, &child, true);
+                if constexpr (is_map<T>::value) {
+                    format_element(ctx, element.first);
+                    ctx.write(": ", 2);
+                    format_tree(ctx, element.second, &child);
+                } else {
+                    format_tree(ctx, element, &child);
+                }
+            }
+        } else {
+            format_element(ctx, v);
+        }
+    }
+
+    template <class Context, class R, enable_if_range<R>>
+    void format_to(Context& ctx, const R& range, const format_spec& spec) {
+        if (spec.flags.prefix) {
+            format_tree(ctx, range, nullptr);
+            return;
+        }
+
+        ctx.write(is_map<R>::value ? '{' : '[');
+        bool first = true;
+        for (const auto& element : range) {
+            if (!first) {
+                ctx.write(", ", 2);
+            }
+            first = false;
+            if constexpr (is_map<R>::value) {
+                format_element(ctx, element.first);
+                ctx.write(": ", 2);
+                format_element(ctx, element.second);
+            } else {
+                format_element(ctx, element);
+            }
+        }
+        ctx.write(is_map<R>::value ? '}' : ']');
+    }
+
+    //------------------------------------------------------------------------------
+    // Name: process_format
+    // Desc: prints the next argument to the Context taking into account the flags,
+    //       width, precision, and modifiers collected along the way. Then will
+    //       recursively continue processing the string
+    //------------------------------------------------------------------------------
+    template <class Context, class T, class... Ts>
+    int process_format(Context& ctx, const char* format, Flags flags, long int width,
+        long int precision, Modifiers modifier, const T& arg, const Ts&... ts) {
+        if (*format == '\0') {
+            ThrowError("Bad Format, incomplete conversion specification");
         }
 
-        return Printf(ctx, format + 1, ts...);
+        if (format_arg(ctx, *format, flags, width, precision, modifier, arg)) {
+            return Printf(ctx, format + 1, ts...);
+        }
+        // nothing was consumed, the argument goes to the next specifier
+        return Printf(ctx, format + 1, arg, ts...);
     }
 
     //------------------------------------------------------------------------------
@@ -985,6 +1476,247 @@ namespace print_detail {
             return ctx.written;
         }
     }
+
+    //------------------------------------------------------------------------------
+    // Compile time format strings, see CCUTILS_FMT
+    //------------------------------------------------------------------------------
+
+    constexpr bool is_conversion(char ch) {
+        for (char c : std::string_view("diuxXobcspn$?eEfFgGaA")) {
+            if (c == ch) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Parses the format string, writing the pieces to specs if it isn't null.
+    // Returns the number of pieces, or SIZE_MAX if a conversion is invalid
+    constexpr size_t parse_format(std::string_view format, format_spec* specs) {
+        size_t count = 0;
+        size_t args = 0;
+        size_t i = 0;
+        while (i < format.size()) {
+            format_spec spec;
+            if (format[i] != '%' || (i + 1 < format.size() && format[i + 1] == '%')) {
+                // literal text, up to the next conversion; %% is the second %
+                spec.offset = format[i] == '%' ? i + 1 : i;
+                i += format[i] == '%' ? 2 : 1;
+                while (i < format.size() && format[i] != '%') {
+                    ++i;
+                }
+                spec.length = i - spec.offset;
+            } else {
+                ++i;
+                for (bool done = false; !done && i < format.size();) {
+                    switch (format[i]) {
+                    case '-':
+                        spec.flags.justify = 1;
+                        spec.flags.padding = 0;
+                        ++i;
+                        break;
+                    case '+':
+                        spec.flags.sign = 1;
+                        spec.flags.space = 0;
+                        ++i;
+                        break;
+                    case ' ':
+                        spec.flags.space = !spec.flags.sign;
+                        ++i;
+                        break;
+                    case '#':
+                        spec.flags.prefix = 1;
+                        ++i;
+                        break;
+                    case '0':
+                        spec.flags.padding = !spec.flags.justify;
+                        ++i;
+                        break;
+                    default:
+                        done = true;
+                    }
+                }
+                if (i < format.size() && format[i] == '*') {
+                    spec.width_arg = args++;
+                    ++i;
+                } else {
+                    for (; i < format.size() && format[i] >= '0' && format[i] <= '9'; ++i) {
+                        spec.width = spec.width * 10 + (format[i] - '0');
+                    }
+                }
+                if (i < format.size() && format[i] == '.') {
+                    ++i;
+                    spec.precision = 0;
+                    if (i < format.size() && format[i] == '*') {
+                        spec.precision_arg = args++;
+                        ++i;
+                    } else {
+                        for (; i < format.size() && format[i] >= '0' && format[i] <= '9'; ++i) {
+                            spec.precision = spec.precision * 10 + (format[i] - '0');
+                        }
+                    }
+                }
+                if (i < format.size()) {
+                    switch (format[i]) {
+                    case 'h':
+                        spec.modifier = Modifiers::MOD_SHORT;
+                        if (++i < format.size() && format[i] == 'h') {
+                            spec.modifier = Modifiers::MOD_CHAR;
+                            ++i;
+                        }
+                        break;
+                    case 'l':
+                        spec.modifier = Modifiers::MOD_LONG;
+                        if (++i < format.size() && format[i] == 'l') {
+                            spec.modifier = Modifiers::MOD_LONG_LONG;
+                            ++i;
+                        }
+                        break;
+                    case 'L':
+                        spec.modifier = Modifiers::MOD_LONG_DOUBLE;
+                        ++i;
+                        break;
+                    case 'j':
+                        spec.modifier = Modifiers::MOD_INTMAX_T;
+                        ++i;
+                        break;
+                    case 'z':
+                        spec.modifier = Modifiers::MOD_SIZE_T;
+                        ++i;
+                        break;
+                    case 't':
+                        spec.modifier = Modifiers::MOD_PTRDIFF_T;
+                        ++i;
+                        break;
+                    default:
+                        break;
+                    }
+                }
+                if (i == format.size() || !is_conversion(format[i])) {
+                    return SIZE_MAX;
+                }
+                spec.conversion = format[i++];
+                spec.arg = args++;
+            }
+            if (specs) {
+                specs[count] = spec;
+            }
+            ++count;
+        }
+        return count;
+    }
+
+    // Whether an argument of type T can be printed with the conversion ch
+    template <class T> constexpr bool accepts(char ch) {
+        using U = std::decay_t<T>;
+        switch (ch) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'b':
+        case 'c':
+        case '*':
+            return std::is_integral<U>::value;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            return std::is_floating_point<U>::value;
+        case 's':
+            return std::is_convertible<U, const char*>::value;
+        case 'p':
+            return std::is_convertible<U, const void*>::value;
+        case 'n':
+            return std::is_pointer<U>::value && std::is_integral<std::remove_pointer_t<U>>::value;
+        default:
+            return true;
+        }
+    }
+
+    struct compiled_format_base {};
+
+    template <class Format> struct compiled_format {
+        static constexpr std::string_view text = Format::value();
+        static constexpr size_t size = parse_format(text, nullptr);
+        static_assert(size != SIZE_MAX, "CCUTILS_FMT: invalid conversion specification");
+
+        static constexpr std::array<format_spec, size> parse() {
+            std::array<format_spec, size> specs {};
+            parse_format(text, specs.data());
+            return specs;
+        }
+        static constexpr std::array<format_spec, size> specs = parse();
+
+        static constexpr size_t args() {
+            size_t count = 0;
+            for (const format_spec& spec : specs) {
+                count += spec.conversion != 0;
+                count += spec.width_arg != SIZE_MAX;
+                count += spec.precision_arg != SIZE_MAX;
+            }
+            return count;
+        }
+    };
+
+    template <class Format, size_t I, class Context, class Tuple>
+    void print_spec(Context& ctx, const Tuple& args) {
+        constexpr format_spec spec = compiled_format<Format>::specs[I];
+        if constexpr (spec.conversion == 0) {
+            if constexpr (spec.length > 0) {
+                ctx.write(Format::value().data() + spec.offset, spec.length);
+            }
+        } else {
+            long int width = spec.width;
+            if constexpr (spec.width_arg != SIZE_MAX) {
+                using W = std::tuple_element_t<spec.width_arg, Tuple>;
+                static_assert(accepts<W>('*'), "CCUTILS_FMT: a * width must be an integer");
+                width = static_cast<long int>(std::get<spec.width_arg>(args));
+            }
+            long int precision = spec.precision;
+            if constexpr (spec.precision_arg != SIZE_MAX) {
+                using P = std::tuple_element_t<spec.precision_arg, Tuple>;
+                static_assert(accepts<P>('*'), "CCUTILS_FMT: a * precision must be an integer");
+                precision = static_cast<long int>(std::get<spec.precision_arg>(args));
+            }
+            using T = std::tuple_element_t<spec.arg, Tuple>;
+            static_assert(accepts<T>(spec.conversion),
+                "CCUTILS_FMT: argument type doesn't match its conversion specifier");
+            format_arg(ctx, spec.conversion, spec.flags, width, precision, spec.modifier,
+                std::get<spec.arg>(args));
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Name: PrintfCompiled
+    // Desc: formats with a CCUTILS_FMT format string: a straight sequence of
+    //       writes and conversions, checked at compile time
+    //------------------------------------------------------------------------------
+    template <class Format, class Context, class... Ts, size_t... I>
+    int PrintfCompiled(Context& ctx, std::index_sequence<I...>, const Ts&... ts) {
+        static_assert(compiled_format<Format>::args() == sizeof...(Ts),
+            "CCUTILS_FMT: the number of arguments doesn't match the format");
+        const std::tuple<const Ts&...> args(ts...);
+        (print_spec<Format, I>(ctx, args), ...);
+        ctx.done();
+        return ctx.written;
+    }
+
+    template <class Format, class Context, class... Ts>
+    int PrintfCompiled(Context& ctx, const Ts&... ts) {
+        return PrintfCompiled<Format>(
+            ctx, std::make_index_sequence<compiled_format<Format>::size>(), ts...);
+    }
+
+    template <class T>
+    using enable_if_compiled_format
+        = std::enable_if_t<std::is_base_of<compiled_format_base, T>::value, int>;
 #undef LIKELY
 #undef UNLIKELY
 }
@@ -1018,10 +1750,58 @@ template <class... Ts> int print(const char* format, const Ts&... ts) {
 
 template <class... Ts> int printn(const char* format, const Ts&... ts) {
     print_detail::stdout_writer ctx;
-    return Printf(ctx, format, ts...) + Printf(ctx, "\n");
+    Printf(ctx, format, ts...);
+    ctx.write('\n');
+    ctx.done();
+    return ctx.written;
+}
+
+//------------------------------------------------------------------------------
+// Name: sprint/print/printn with CCUTILS_FMT
+// Desc: the same, with the format parsed at compile time
+//------------------------------------------------------------------------------
+template <class Format, class... Ts, print_detail::enable_if_compiled_format<Format> = 0>
+int sprint(std::ostream& os, Format, const Ts&... ts) {
+    print_detail::ostream_writer ctx(os);
+    return print_detail::PrintfCompiled<Format>(ctx, ts...);
+}
+
+template <class Format, class... Ts, print_detail::enable_if_compiled_format<Format> = 0>
+int sprint(char* str, size_t size, Format, const Ts&... ts) {
+    print_detail::buffer_writer ctx(str, size);
+    return print_detail::PrintfCompiled<Format>(ctx, ts...);
+}
+
+template <class Format, class... Ts, print_detail::enable_if_compiled_format<Format> = 0>
+int print(Format, const Ts&... ts) {
+    print_detail::stdout_writer ctx;
+    return print_detail::PrintfCompiled<Format>(ctx, ts...);
+}
+
+template <class Format, class... Ts, print_detail::enable_if_compiled_format<Format> = 0>
+int printn(Format, const Ts&... ts) {
+    print_detail::stdout_writer ctx;
+    print_detail::PrintfCompiled<Format>(ctx, ts...);
+    ctx.write('\n');
+    ctx.done();
+    return ctx.written;
 }
 }
 
+//------------------------------------------------------------------------------
+// Name: CCUTILS_FMT
+// Desc: a format string literal that is parsed at compile time, so that wrong
+//       conversions and argument counts or types are compile errors, e.g.
+//       ccutils::print(CCUTILS_FMT("%s: %5.2f\n"), name, value);
+//------------------------------------------------------------------------------
+#define CCUTILS_FMT(format)                                                                       \
+    ([] {                                                                                         \
+        struct CompiledFormat : ::ccutils::print_detail::compiled_format_base {                   \
+            static constexpr std::string_view value() { return format; }                          \
+        };                                                                                        \
+        return CompiledFormat {};                                                                 \
+    }())
+
 // int mymain(int argc, char *argv[]) {
 //     printn("%$ %$ %$", "fawefawef", 1, 2);
 //     return 0;
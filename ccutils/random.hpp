@@ -2,13 +2,20 @@
 
 #include "forEachAligned.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <mutex>
 #include <random>
 #include <cerrno>
 #include <cstdint>
+#include <type_traits>
 #include <system_error>
 
 #include <linux/random.h>
+#include <pthread.h>
 #include <linux/version.h>
 #include <sys/syscall.h>
 #include <unistd.h>
@@ -16,15 +23,15 @@
 namespace ccutils {
 
 /** Fill the range `[begin, end)` with random data from a random device. **/
-void randomFill(char* begin, char* end);
+inline void randomFill(char* begin, char* end);
 
 #if LINUX_VERSION_CODE > KERNEL_VERSION(3, 17, 0)
 
-static long getRandom(void* buf, std::size_t buf_len, unsigned int flags) {
+inline long getRandom(void* buf, std::size_t buf_len, unsigned int flags) {
     return syscall(SYS_getrandom, buf, buf_len, flags);
 }
 
-void randomFill(char* begin, char* end) {
+inline void randomFill(char* begin, char* end) {
     while (begin < end) {
         long bytes_read = getRandom(begin, end - begin, 0);
         if (bytes_read > 0) {
@@ -40,7 +47,7 @@ void randomFill(char* begin, char* end) {
 
 #else  // older versions of Linux
 
-void randomFill(char* begin, char* end) {
+inline void randomFill(char* begin, char* end) {
     std::random_device rng;
     std::uniform_int_distribution<std::uint32_t> dist;
 
@@ -51,8 +58,98 @@ void randomFill(char* begin, char* end) {
 
 #endif
 
-/** A seed sequence which pulls data from a random device via \c randomFill. This is a partial implementation of the
- *  seed sequence concept and can be used as one in most cases, but it lacks functions that allow for storing or loading
+/** A process-wide store of kernel entropy for seeding. Bytes are fetched from \c randomFill in batches of
+ *  \c BATCH_SIZE and handed to threads in chunks of \c CHUNK_SIZE; a thread consumes its chunk without any locking
+ *  and only takes the pool's mutex to grab the next one. Every byte is handed out once.
+ *
+ *  After \c fork() the child drops both the shared batch and the per-thread chunks inherited from the parent, so
+ *  parent and child never draw the same seed material. Its refills start at a single chunk and double up to a
+ *  batch, so a short-lived worker that only seeds a generator or two doesn't pay for a whole batch.
+ **/
+class EntropyPool {
+public:
+    static constexpr std::size_t BATCH_SIZE = 64 << 10;
+    static constexpr std::size_t CHUNK_SIZE = 256;
+
+    static EntropyPool& instance() {
+        static EntropyPool pool;
+        return pool;
+    }
+
+    /** Fills the range `[begin, end)` with bytes from the pool. **/
+    void fill(char* begin, char* end) {
+        LocalChunk& local = localChunk();
+        while (begin < end) {
+            if (local.offset == CHUNK_SIZE || local.generation != generation_.load(std::memory_order_relaxed))
+                takeChunk(local);
+            const std::size_t count = std::min<std::size_t>(end - begin, CHUNK_SIZE - local.offset);
+            std::memcpy(begin, local.bytes + local.offset, count);
+            std::memset(local.bytes + local.offset, 0, count);
+            local.offset += count;
+            begin += count;
+        }
+    }
+
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        fill(reinterpret_cast<char*>(&value), reinterpret_cast<char*>(&value) + sizeof(T));
+        return value;
+    }
+
+private:
+    struct LocalChunk {
+        char bytes[CHUNK_SIZE];
+        std::size_t offset = CHUNK_SIZE;
+        std::uint64_t generation = 0;
+    };
+
+    EntropyPool() {
+        pthread_atfork(&EntropyPool::beforeFork, &EntropyPool::afterForkParent, &EntropyPool::afterForkChild);
+    }
+
+    static LocalChunk& localChunk() {
+        thread_local LocalChunk chunk;
+        return chunk;
+    }
+
+    void takeChunk(LocalChunk& local) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (offset_ + CHUNK_SIZE > filled_) {
+            randomFill(batch_, batch_ + refill_);
+            filled_ = refill_;
+            refill_ = std::min(2 * refill_, BATCH_SIZE);
+            offset_ = 0;
+        }
+        std::memcpy(local.bytes, batch_ + offset_, CHUNK_SIZE);
+        std::memset(batch_ + offset_, 0, CHUNK_SIZE);
+        offset_ += CHUNK_SIZE;
+        local.offset = 0;
+        local.generation = generation_.load(std::memory_order_relaxed);
+    }
+
+    /// Holding the mutex across fork() keeps the child from inheriting it locked by a thread that no longer exists.
+    static void beforeFork() { instance().mutex_.lock(); }
+    static void afterForkParent() { instance().mutex_.unlock(); }
+    static void afterForkChild() {
+        EntropyPool& pool = instance();
+        pool.offset_ = pool.filled_ = 0;
+        pool.refill_ = CHUNK_SIZE;
+        pool.generation_.fetch_add(1, std::memory_order_relaxed);
+        pool.mutex_.unlock();
+    }
+
+    std::mutex mutex_;
+    std::atomic<std::uint64_t> generation_{1};
+    std::size_t offset_ = 0;
+    std::size_t filled_ = 0;
+    std::size_t refill_ = BATCH_SIZE;
+    char batch_[BATCH_SIZE];
+};
+
+/** A seed sequence which pulls data from the \c EntropyPool. This is a partial implementation of the seed sequence
+ *  concept and can be used as one in most cases, but it lacks functions that allow for storing or loading
  *  repeatable state.
  *
  *  \see randomSeeded
@@ -60,10 +157,11 @@ void randomFill(char* begin, char* end) {
 class RandomSeedSeq {
 public:
     using ResultType = std::uint32_t;
+    using result_type = ResultType;
 
 public:
     void generate(ResultType* begin, ResultType* end) {
-        randomFill(reinterpret_cast<char*>(begin), reinterpret_cast<char*>(end));
+        EntropyPool::instance().fill(reinterpret_cast<char*>(begin), reinterpret_cast<char*>(end));
     }
 };
 
@@ -83,8 +181,275 @@ TRandomNumberEngine randomSeeded() {
     return TRandomNumberEngine(rss);
 }
 
-auto random() {
+inline auto random() {
     return randomSeeded<std::mt19937>();
 }
 
+class XoshiroLanes;
+
+namespace detail {
+
+inline std::uint64_t splitMix64(std::uint64_t& x) {
+    std::uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+inline std::uint64_t rotl64(std::uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/** Pulls `N` 64-bit words out of a seed sequence. **/
+template <std::size_t N, typename TSeedSeq>
+void seedWords(TSeedSeq& seq, std::uint64_t (&out)[N]) {
+    typename TSeedSeq::result_type words[2 * N];
+    seq.generate(words, words + 2 * N);
+    for (std::size_t i = 0; i < N; ++i)
+        out[i] = std::uint64_t(std::uint32_t(words[2 * i])) | std::uint64_t(words[2 * i + 1]) << 32;
+}
+
+template <typename TSeedSeq, typename TEngine>
+using EnableIfSeedSeq = std::enable_if_t<!std::is_convertible_v<TSeedSeq, std::uint64_t>
+                                         && !std::is_same_v<std::decay_t<TSeedSeq>, TEngine>>;
+
+}  // namespace detail
+
+/** xoshiro256** by Blackman and Vigna: 32 bytes of state, period 2^256 - 1, and one of the fastest
+ *  generators with no known statistical flaws. The engine of choice unless there is a reason to pick another.
+ *
+ *  \c jump() advances the state by 2^128 steps and \c long_jump() by 2^192, so handing every thread a copy that
+ *  was jumped a different number of times gives non-overlapping streams.
+ *
+ *  \see https://prng.di.unimi.it/
+ **/
+class Xoshiro256StarStar {
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    explicit Xoshiro256StarStar(std::uint64_t seed = 0) { this->seed(seed); }
+
+    template <typename TSeedSeq, typename = detail::EnableIfSeedSeq<TSeedSeq, Xoshiro256StarStar>>
+    explicit Xoshiro256StarStar(TSeedSeq& seq) {
+        this->seed(seq);
+    }
+
+    /** The state is expanded from \c seed with splitmix64, as recommended by the authors. **/
+    void seed(std::uint64_t seed) {
+        for (auto& word : s_)
+            word = detail::splitMix64(seed);
+    }
+
+    template <typename TSeedSeq, typename = detail::EnableIfSeedSeq<TSeedSeq, Xoshiro256StarStar>>
+    void seed(TSeedSeq& seq) {
+        detail::seedWords(seq, s_);
+        if ((s_[0] | s_[1] | s_[2] | s_[3]) == 0)
+            seed(0);
+    }
+
+    result_type operator()() {
+        const std::uint64_t result = detail::rotl64(s_[1] * 5, 7) * 9;
+        const std::uint64_t t = s_[1] << 17;
+
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = detail::rotl64(s_[3], 45);
+
+        return result;
+    }
+
+    void discard(unsigned long long n) {
+        while (n--)
+            (*this)();
+    }
+
+    void jump() {
+        static constexpr std::uint64_t poly[] = {
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        jumpBy(poly);
+    }
+
+    void long_jump() {
+        static constexpr std::uint64_t poly[] = {
+            0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+        jumpBy(poly);
+    }
+
+    friend bool operator==(const Xoshiro256StarStar& a, const Xoshiro256StarStar& b) {
+        return std::equal(std::begin(a.s_), std::end(a.s_), std::begin(b.s_));
+    }
+    friend bool operator!=(const Xoshiro256StarStar& a, const Xoshiro256StarStar& b) { return !(a == b); }
+
+private:
+    void jumpBy(const std::uint64_t (&poly)[4]) {
+        std::uint64_t t[4] = {0, 0, 0, 0};
+        for (std::uint64_t word : poly) {
+            for (int b = 0; b < 64; ++b) {
+                if (word & (std::uint64_t(1) << b)) {
+                    for (int i = 0; i < 4; ++i)
+                        t[i] ^= s_[i];
+                }
+                (*this)();
+            }
+        }
+        std::copy(std::begin(t), std::end(t), std::begin(s_));
+    }
+
+    friend class XoshiroLanes;
+
+    std::uint64_t s_[4];
+};
+
+/** PCG64 (XSL-RR 128/64) by O'Neill: a 128-bit LCG with a permuted output. Slower than xoshiro256** but its
+ *  state can be advanced by any distance in O(log n), and the increment selects one of 2^127 distinct streams.
+ *
+ *  \c jump() advances the state by 2^64 steps and \c long_jump() by 2^96.
+ *
+ *  \see https://www.pcg-random.org/
+ **/
+class Pcg64 {
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    explicit Pcg64(std::uint64_t seed = 0, std::uint64_t stream = 0) { this->seed(seed, stream); }
+
+    template <typename TSeedSeq, typename = detail::EnableIfSeedSeq<TSeedSeq, Pcg64>>
+    explicit Pcg64(TSeedSeq& seq) {
+        this->seed(seq);
+    }
+
+    void seed(std::uint64_t seed, std::uint64_t stream = 0) {
+        std::uint64_t words[4];
+        for (auto& word : words)
+            word = detail::splitMix64(seed);
+        init(words[0], words[1], words[2] ^ stream, words[3]);
+    }
+
+    template <typename TSeedSeq, typename = detail::EnableIfSeedSeq<TSeedSeq, Pcg64>>
+    void seed(TSeedSeq& seq) {
+        std::uint64_t words[4];
+        detail::seedWords(seq, words);
+        init(words[0], words[1], words[2], words[3]);
+    }
+
+    result_type operator()() {
+        state_ = state_ * multiplier() + inc_;
+        const std::uint64_t xored = std::uint64_t(state_ >> 64) ^ std::uint64_t(state_);
+        const int rot = int(state_ >> 122);
+        return (xored >> rot) | (xored << ((-rot) & 63));
+    }
+
+    /** Advances the state by `delta` steps in O(log delta) (Brown, "Random Number Generation with Arbitrary
+     *  Stride"). **/
+    void advance(__uint128_t delta) {
+        __uint128_t acc_mult = 1, acc_plus = 0;
+        __uint128_t cur_mult = multiplier(), cur_plus = inc_;
+        while (delta) {
+            if (delta & 1) {
+                acc_mult *= cur_mult;
+                acc_plus = acc_plus * cur_mult + cur_plus;
+            }
+            cur_plus = (cur_mult + 1) * cur_plus;
+            cur_mult *= cur_mult;
+            delta >>= 1;
+        }
+        state_ = acc_mult * state_ + acc_plus;
+    }
+
+    void discard(unsigned long long n) { advance(n); }
+    void jump() { advance(__uint128_t(1) << 64); }
+    void long_jump() { advance(__uint128_t(1) << 96); }
+
+    friend bool operator==(const Pcg64& a, const Pcg64& b) { return a.state_ == b.state_ && a.inc_ == b.inc_; }
+    friend bool operator!=(const Pcg64& a, const Pcg64& b) { return !(a == b); }
+
+private:
+    static constexpr __uint128_t multiplier() {
+        return (__uint128_t(0x2360ed051fc65da4ULL) << 64) | 0x4385df649fccf645ULL;
+    }
+
+    void init(std::uint64_t state_hi, std::uint64_t state_lo, std::uint64_t inc_hi, std::uint64_t inc_lo) {
+        inc_ = ((__uint128_t(inc_hi) << 64) | inc_lo) << 1 | 1;
+        state_ = 0;
+        (*this)();
+        state_ += (__uint128_t(state_hi) << 64) | state_lo;
+        (*this)();
+    }
+
+    __uint128_t state_;
+    __uint128_t inc_;
+};
+
+/** wyrand by Wang Yi: a single 64-bit counter pushed through a multiply-fold. The fastest of the three, with a
+ *  period of 2^64. Since the state is a Weyl sequence, jumping is a single multiply-add:
+ *  \c jump() advances by 2^48 steps and \c long_jump() by 2^56.
+ *
+ *  \see https://github.com/wangyi-fudan/wyhash
+ **/
+class WyRand {
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    explicit WyRand(std::uint64_t seed = 0) { this->seed(seed); }
+
+    template <typename TSeedSeq, typename = detail::EnableIfSeedSeq<TSeedSeq, WyRand>>
+    explicit WyRand(TSeedSeq& seq) {
+        this->seed(seq);
+    }
+
+    void seed(std::uint64_t seed) { state_ = detail::splitMix64(seed); }
+
+    template <typename TSeedSeq, typename = detail::EnableIfSeedSeq<TSeedSeq, WyRand>>
+    void seed(TSeedSeq& seq) {
+        std::uint64_t words[1];
+        detail::seedWords(seq, words);
+        state_ = words[0];
+    }
+
+    result_type operator()() {
+        state_ += increment;
+        const __uint128_t r = __uint128_t(state_) * (state_ ^ 0xe7037ed1a0b428dbULL);
+        return std::uint64_t(r >> 64) ^ std::uint64_t(r);
+    }
+
+    void advance(std::uint64_t delta) { state_ += delta * increment; }
+    void discard(unsigned long long n) { advance(n); }
+    void jump() { advance(std::uint64_t(1) << 48); }
+    void long_jump() { advance(std::uint64_t(1) << 56); }
+
+    friend bool operator==(const WyRand& a, const WyRand& b) { return a.state_ == b.state_; }
+    friend bool operator!=(const WyRand& a, const WyRand& b) { return !(a == b); }
+
+private:
+    static constexpr std::uint64_t increment = 0xa0761d6478bd642fULL;
+
+    std::uint64_t state_;
+};
+
+/** Per-thread xoshiro256** seeded from \c RandomSeedSeq the first time the calling thread asks for it. Cheap
+ *  enough to call on every use; the reference must not be handed to other threads.
+ *
+ *  \example
+ *  \code
+ *  std::uniform_int_distribution<int> dist(1, 6);
+ *  int roll = dist(threadRandom());
+ *  \endcode
+ **/
+inline Xoshiro256StarStar& threadRandom() {
+    thread_local Xoshiro256StarStar rng = randomSeeded<Xoshiro256StarStar>();
+    return rng;
+}
+
 }  // namespace ccutils
@@ -1,20 +1,11 @@
 #pragma once
 
-#include <SipHash.hpp>
+#include "random.hpp"
 
-#include <time.h>
-#include <unistd.h>
-#include <sys/types.h>
+#include <cstdint>
 
-uint64_t randomSeed()
+/// 64 bits of seed material from the process-wide entropy pool.
+inline uint64_t randomSeed()
 {
-    struct timespec times;
-    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &times))
-        return 0;
-    SipHash hash;
-    hash.update(times.tv_nsec);
-    hash.update(times.tv_sec);
-    hash.update(getpid());
-    hash.update(&times);
-    return hash.get64();
+    return ccutils::EntropyPool::instance().get<uint64_t>();
 }
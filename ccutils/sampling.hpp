@@ -0,0 +1,275 @@
+#pragma once
+
+#include "fastRandom.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ccutils {
+
+namespace detail {
+
+template <typename TRandomNumberEngine>
+constexpr bool isFullWord64() {
+    return TRandomNumberEngine::min() == 0 && TRandomNumberEngine::max() == std::numeric_limits<std::uint64_t>::max();
+}
+
+/** A double in `[0, 1)`. One call for 64-bit engines such as \c Xoshiro256StarStar, the generic (and slower)
+ *  \c std::generate_canonical otherwise. **/
+template <typename TRandomNumberEngine>
+double uniform01(TRandomNumberEngine& rng) {
+    if constexpr (isFullWord64<TRandomNumberEngine>())
+        return double(rng() >> 11) * 0x1.0p-53;
+    else
+        return std::generate_canonical<double, 53>(rng);
+}
+
+/** A double in `(0, 1]`, safe to take the logarithm of. **/
+template <typename TRandomNumberEngine>
+double uniform01Open(TRandomNumberEngine& rng) {
+    return 1.0 - uniform01(rng);
+}
+
+}  // namespace detail
+
+/** Samples indices `[0, n)` with probabilities proportional to the given weights in O(1) per draw, using Vose's
+ *  variant of Walker's alias method. Building the table is O(n).
+ *
+ *  With a 64-bit engine every draw takes a single random word: the high half of `word * n` picks the column and the
+ *  low half, which is uniform given the column, is compared against the column's threshold.
+ *
+ *  \example
+ *  \code
+ *  AliasTable table({0.5, 0.25, 0.25});
+ *  std::size_t i = table(threadRandom());
+ *  \endcode
+ **/
+class AliasTable {
+public:
+    AliasTable() = default;
+
+    explicit AliasTable(const std::vector<double>& weights) {
+        const std::size_t n = weights.size();
+        if (n == 0 || n > std::numeric_limits<std::uint32_t>::max())
+            throw std::invalid_argument("AliasTable: the number of weights must be in [1, 2^32)");
+
+        double sum = 0;
+        for (double w : weights) {
+            if (!(w >= 0) || std::isinf(w))
+                throw std::invalid_argument("AliasTable: weights must be finite and non-negative");
+            sum += w;
+        }
+        if (sum <= 0)
+            throw std::invalid_argument("AliasTable: weights must not all be zero");
+
+        std::vector<double> scaled(n);
+        std::vector<std::uint32_t> small, large;
+        for (std::size_t i = 0; i < n; ++i) {
+            scaled[i] = weights[i] * n / sum;
+            (scaled[i] < 1 ? small : large).push_back(i);
+        }
+
+        columns_.resize(n);
+        while (!small.empty() && !large.empty()) {
+            const std::uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            columns_[s] = {toThreshold(scaled[s]), l};
+            scaled[l] -= 1 - scaled[s];
+            if (scaled[l] < 1) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // Whatever is left is 1 up to rounding errors.
+        for (std::uint32_t i : large)
+            columns_[i] = {ALWAYS, i};
+        for (std::uint32_t i : small)
+            columns_[i] = {ALWAYS, i};
+    }
+
+    std::size_t size() const { return columns_.size(); }
+
+    template <typename TRandomNumberEngine>
+    std::size_t operator()(TRandomNumberEngine& rng) const {
+        if constexpr (detail::isFullWord64<TRandomNumberEngine>()) {
+            const __uint128_t m = __uint128_t(rng()) * columns_.size();
+            const Column& column = columns_[std::size_t(m >> 64)];
+            return std::uint64_t(m) < column.threshold || column.threshold == ALWAYS ? std::size_t(m >> 64)
+                                                                                     : column.alias;
+        } else {
+            std::uniform_int_distribution<std::size_t> pick(0, columns_.size() - 1);
+            const std::size_t i = pick(rng);
+            const Column& column = columns_[i];
+            return column.threshold == ALWAYS || detail::uniform01(rng) * 0x1.0p64 < double(column.threshold)
+                       ? i
+                       : column.alias;
+        }
+    }
+
+private:
+    /// The column's own index is taken when the low half of the draw is below `threshold` (out of 2^64).
+    struct Column {
+        std::uint64_t threshold;
+        std::uint32_t alias;
+    };
+
+    static constexpr std::uint64_t ALWAYS = std::numeric_limits<std::uint64_t>::max();
+
+    static std::uint64_t toThreshold(double p) {
+        return p <= 0 ? 0 : std::uint64_t(std::ldexp(p, 64));
+    }
+
+    std::vector<Column> columns_;
+};
+
+/** Zipf distribution over the ranks `[1, n]`: P(k) is proportional to 1 / k^s, for any exponent s > 0. Uses
+ *  Hörmann and Derflinger's rejection-inversion, so construction is O(1), there is no table and a draw costs a
+ *  couple of transcendental functions with an acceptance rate close to 1.
+ *
+ *  \see W. Hörmann, G. Derflinger, "Rejection-inversion to generate variates from monotone discrete distributions"
+ **/
+class ZipfDistribution {
+public:
+    using result_type = std::uint64_t;
+
+    ZipfDistribution(std::uint64_t n, double s)
+        : n_(n)
+        , s_(s) {
+        if (n == 0 || !(s > 0))
+            throw std::invalid_argument("ZipfDistribution: needs n >= 1 and s > 0");
+        hIntegralX1_ = hIntegral(1.5) - 1;
+        hIntegralN_ = hIntegral(n + 0.5);
+        sDiv_ = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+    }
+
+    result_type min() const { return 1; }
+    result_type max() const { return n_; }
+
+    template <typename TRandomNumberEngine>
+    result_type operator()(TRandomNumberEngine& rng) const {
+        while (true) {
+            const double u = hIntegralN_ + detail::uniform01(rng) * (hIntegralX1_ - hIntegralN_);
+            const double x = hIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            k = std::clamp(k, 1.0, double(n_));
+            if (k - x <= sDiv_ || u >= hIntegral(k + 0.5) - h(k))
+                return result_type(k);
+        }
+    }
+
+private:
+    double h(double x) const { return std::exp(-s_ * std::log(x)); }
+
+    double hIntegral(double x) const {
+        const double logX = std::log(x);
+        return expm1Div((1 - s_) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const {
+        double t = x * (1 - s_);
+        if (t < -1)
+            t = -1;
+        return std::exp(log1pDiv(t) * x);
+    }
+
+    /// log1p(x) / x and expm1(x) / x, continuous at 0.
+    static double log1pDiv(double x) {
+        return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+    }
+    static double expm1Div(double x) {
+        return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+    }
+
+    std::uint64_t n_;
+    double s_;
+    double hIntegralX1_;
+    double hIntegralN_;
+    double sDiv_;
+};
+
+/** Keeps a weighted random sample of `k` items out of a stream of unknown length, without replacement: every item
+ *  ends up in the sample with the probability it would have when drawing items one at a time with probability
+ *  proportional to their weights (Efraimidis and Spirakis).
+ *
+ *  Implements the exponential jumps variant (A-ExpJ): once the reservoir is full, the weight to skip before the next
+ *  replacement is drawn up front, so random numbers are generated O(k log(n / k)) times instead of once per item.
+ **/
+template <typename T>
+class WeightedReservoir {
+public:
+    explicit WeightedReservoir(std::size_t k)
+        : k_(k) {
+        if (k == 0)
+            throw std::invalid_argument("WeightedReservoir: k must be positive");
+        heap_.reserve(k);
+    }
+
+    template <typename U, typename TRandomNumberEngine>
+    void add(U&& item, double weight, TRandomNumberEngine& rng) {
+        if (!(weight > 0))
+            return;
+
+        if (heap_.size() < k_) {
+            push(std::log(detail::uniform01Open(rng)) / weight, std::forward<U>(item));
+            if (heap_.size() == k_)
+                drawSkip(rng);
+            return;
+        }
+
+        skip_ -= weight;
+        if (skip_ > 0)
+            return;
+
+        // The item replaces the current minimum with a key drawn from (threshold, 0].
+        const double threshold = heap_.front().first;
+        const double tw = std::exp(threshold * weight);
+        const double r = tw + (1 - tw) * detail::uniform01Open(rng);
+        std::pop_heap(heap_.begin(), heap_.end(), Greater());
+        heap_.pop_back();
+        push(std::log(r) / weight, std::forward<U>(item));
+        drawSkip(rng);
+    }
+
+    std::size_t size() const { return heap_.size(); }
+
+    /** The sampled items, in no particular order. **/
+    std::vector<T> sample() const {
+        std::vector<T> items;
+        items.reserve(heap_.size());
+        for (const auto& entry : heap_)
+            items.push_back(entry.second);
+        return items;
+    }
+
+private:
+    /// Keys are log(u) / w, i.e. the log of Efraimidis-Spirakis' u^(1/w); the reservoir keeps the k largest.
+    using Entry = std::pair<double, T>;
+
+    struct Greater {
+        bool operator()(const Entry& a, const Entry& b) const { return a.first > b.first; }
+    };
+
+    template <typename U>
+    void push(double key, U&& item) {
+        heap_.emplace_back(key, std::forward<U>(item));
+        std::push_heap(heap_.begin(), heap_.end(), Greater());
+    }
+
+    template <typename TRandomNumberEngine>
+    void drawSkip(TRandomNumberEngine& rng) {
+        skip_ = std::log(detail::uniform01Open(rng)) / heap_.front().first;
+    }
+
+    std::size_t k_;
+    std::vector<Entry> heap_;
+    double skip_ = 0;
+};
+
+}  // namespace ccutils
@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <exception>
 #include <functional>
 #include <new>
 #include <type_traits>
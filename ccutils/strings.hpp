@@ -1,27 +1,265 @@
+#pragma once
+
+#include "CharClass.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace ccutils {
-std::vector<std::string> splitString(const std::string& str, const std::string& delimiter) {
+
+namespace detail {
+
+/// Finds the occurrences of a single byte 64 bytes at a time: each block is turned into a bitmask with SIMD compares
+/// (AVX2 when compiled for it, SSE2 otherwise), and the positions are then popped off the mask one by one.
+class ByteScanner {
+public:
+    static constexpr size_t BLOCK = 64;
+
+    ByteScanner() = default;
+
+    ByteScanner(const char* begin, const char* end, char byte)
+        : block_(begin)
+        , end_(end)
+        , byte_(byte) {
+        mask_ = scan(block_);
+    }
+
+    /// The next occurrence at or after `from`, or the end of the range. `from` never goes backwards.
+    const char* next(const char* from) {
+        while (true) {
+            if (from - block_ >= static_cast<ptrdiff_t>(BLOCK)) {
+                block_ += (from - block_) / BLOCK * BLOCK;
+                if (block_ >= end_)
+                    return end_;
+                mask_ = scan(block_);
+            }
+            uint64_t mask = mask_ & (~uint64_t(0) << (from - block_));
+            if (mask)
+                return block_ + __builtin_ctzll(mask);
+            from = block_ + BLOCK;
+            if (from >= end_)
+                return end_;
+        }
+    }
+
+private:
+    uint64_t scan(const char* p) const {
+        if (end_ - p < static_cast<ptrdiff_t>(BLOCK)) {
+            uint64_t mask = 0;
+            for (size_t i = 0; p + i < end_; ++i)
+                mask |= uint64_t(p[i] == byte_) << i;
+            return mask;
+        }
+#if defined(__AVX2__)
+        const __m256i needle = _mm256_set1_epi8(byte_);
+        uint64_t lo = uint32_t(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), needle)));
+        uint64_t hi = uint32_t(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), needle)));
+        return lo | hi << 32;
+#elif defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi8(byte_);
+        uint64_t mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+            mask |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)))) << (16 * i);
+        }
+        return mask;
+#else
+        uint64_t mask = 0;
+        for (const char* q = p; (q = static_cast<const char*>(std::memchr(q, byte_, p + BLOCK - q))); ++q)
+            mask |= uint64_t(1) << (q - p);
+        return mask;
+#endif
+    }
+
+    const char* block_ = nullptr;
+    const char* end_ = nullptr;
+    uint64_t mask_ = 0;
+    char byte_ = 0;
+};
+
+/// Delimiter policies for SplitRange: where the next delimiter starts and how long it is.
+class ByteDelimiter {
+public:
+    ByteDelimiter(std::string_view str, char delimiter)
+        : scanner_(str.data(), str.data() + str.size(), delimiter) {}
+
+    const char* find(const char* from, const char*) { return scanner_.next(from); }
+    static constexpr size_t size() { return 1; }
+
+private:
+    ByteScanner scanner_;
+};
+
+class StringDelimiter {
+public:
+    StringDelimiter(std::string_view, std::string_view delimiter)
+        : delimiter_(delimiter) {}
+
+    const char* find(const char* from, const char* end) {
+        if (delimiter_.empty())
+            return end;
+        auto pos = std::string_view(from, end - from).find(delimiter_);
+        return pos == std::string_view::npos ? end : from + pos;
+    }
+    size_t size() const { return delimiter_.size(); }
+
+private:
+    std::string_view delimiter_;
+};
+
+} // namespace detail
+
+/** A lazy range over the tokens of a string, produced one at a time as `std::string_view`s into the original string.
+ *  Nothing is allocated. Like `splitString`, `n` delimiters always give `n + 1` tokens, empty ones included.
+ *  Created by `split`.
+ **/
+template <typename Delimiter> class SplitRange {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        iterator() = default;
+
+        reference operator*() const { return token_; }
+        pointer operator->() const { return &token_; }
+
+        iterator& operator++() {
+            if (last_)
+                done_ = true;
+            else
+                advance(token_.data() + token_.size() + delimiter_->size());
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator prev(*this);
+            operator++();
+            return prev;
+        }
+
+        bool operator==(const iterator& other) const { return done_ == other.done_; }
+        bool operator!=(const iterator& other) const { return !operator==(other); }
+
+    private:
+        friend SplitRange;
+
+        iterator(Delimiter* delimiter, const char* begin, const char* end)
+            : delimiter_(delimiter)
+            , end_(end) {
+            advance(begin);
+        }
+
+        void advance(const char* from) {
+            const char* pos = delimiter_->find(from, end_);
+            token_ = std::string_view(from, pos - from);
+            last_ = pos == end_;
+        }
+
+        Delimiter* delimiter_ = nullptr;
+        const char* end_ = nullptr;
+        std::string_view token_;
+        bool last_ = true;
+        bool done_ = true;
+    };
+
+    template <typename D>
+    SplitRange(std::string_view str, D delimiter)
+        : str_(str)
+        , delimiter_(str, delimiter) {}
+
+    /// The range can be iterated once: the delimiter search state lives in the range.
+    iterator begin() {
+        iterator it(&delimiter_, str_.data(), str_.data() + str_.size());
+        it.done_ = false;
+        return it;
+    }
+    iterator end() { return {}; }
+
+    /// Collects the remaining tokens, for when a container is needed after all.
+    std::vector<std::string_view> toVector() {
+        return std::vector<std::string_view>(begin(), end());
+    }
+
+private:
+    std::string_view str_;
+    Delimiter delimiter_;
+};
+
+/** Splits `str` on a single byte, scanning for the delimiter 64 bytes at a time with SIMD compares.
+ *
+ *  \example
+ *  \code
+ *  for (std::string_view field : split(line, '\t'))
+ *      consume(field);
+ *  \endcode
+ **/
+inline SplitRange<detail::ByteDelimiter> split(std::string_view str, char delimiter) {
+    return { str, delimiter };
+}
+
+/** Splits `str` on a multi-character delimiter. An empty delimiter yields `str` as the only token. **/
+inline SplitRange<detail::StringDelimiter> split(std::string_view str, std::string_view delimiter) {
+    return { str, delimiter };
+}
+
+inline std::vector<std::string> splitString(const std::string& str, const std::string& delimiter) {
     std::vector<std::string> strings;
+    if (delimiter.empty()) {
+        strings.push_back(str);
+        return strings;
+    }
     std::string::size_type pos = 0;
     std::string::size_type prev = 0;
     while ((pos = str.find(delimiter, prev)) != std::string::npos) {
         strings.push_back(str.substr(prev, pos - prev));
-        prev = pos + 1;
+        prev = pos + delimiter.size();
     }
     strings.push_back(str.substr(prev));
     return strings;
 }
 
-void trimInPlace(std::string& s) {
-    auto f = [](char c) { return !isspace(c); };
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), f));
-    s.erase(std::find_if(s.rbegin(), s.rend(), f).base(), s.end());
+/** `s` without leading and trailing whitespace (as in the C locale), as a view into `s`. The boundaries are found 16
+ *  or 32 bytes at a time with \c CharClass, so long runs of padding are cheap.
+ **/
+inline std::string_view trim(std::string_view s) {
+    static constexpr CharClass whitespace = CharClass::whitespace();
+    const size_t first = findFirstNotOf(s, whitespace);
+    if (first == std::string_view::npos)
+        return {};
+    return s.substr(first, findLastNotOf(s, whitespace) - first + 1);
+}
+
+inline std::string_view trim(const char* s) {
+    return trim(std::string_view(s));
+}
+
+inline void trimInPlace(std::string& s) {
+    const std::string_view trimmed = trim(std::string_view(s));
+    if (trimmed.size() == s.size())
+        return;
+    // Move the remaining bytes once rather than erasing from both ends.
+    std::memmove(&s[0], trimmed.data(), trimmed.size());
+    s.resize(trimmed.size());
 }
 
-std::string trim(std::string s) {
+inline std::string trim(std::string s) {
     trimInPlace(s);
     return s;
 }
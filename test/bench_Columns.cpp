@@ -0,0 +1,55 @@
+#include <iostream>
+#include <string>
+
+#include <Columns.hpp>
+#include <microbench.hpp>
+#include <random.hpp>
+
+using namespace std;
+
+int main() {
+    // a diagnostic table: a narrow column of names next to long wrapped messages, 100k+ rows
+    auto& rng = ccutils::threadRandom();
+    static const char* words[] = { "request", "timeout", "(retry)", "backend", "db.query",
+        "user=42", "failed,", "served", "in", "12ms;", "cache", "miss" };
+    string names, messages;
+    for (size_t i = 0; i < 100000; ++i) {
+        names += words[rng() % 12];
+        names += '\n';
+        for (size_t j = 0, n = 4 + rng() % 20; j < n; ++j) {
+            messages += words[rng() % 12];
+            messages += ' ';
+        }
+        messages += '\n';
+    }
+    const auto table = ccutils::Column(names).width(12) + ccutils::Spacer(2)
+        + ccutils::Column(messages).width(60).indent(2);
+
+    size_t sink = 0;
+    cout << "Columns::toString: " << ccutils::microbench<chrono::milliseconds, 1, 5>([&] {
+        sink += table.toString().size();
+    }) << " ms" << endl;
+
+    cout << "Columns iterators: " << ccutils::microbench<chrono::milliseconds, 1, 5>([&] {
+        for (const auto& line : table)
+            sink += line.size();
+    }) << " ms" << endl;
+
+    // the same table in Japanese: no spaces, two columns a character, breaks between any two
+    static const char* kana[] = { "リクエスト", "タイムアウト", "（再試行）", "バックエンド", "クエリ",
+        "ユーザー", "失敗、", "処理済み", "で", "１２ミリ秒；", "キャッシュ", "ミス" };
+    string wide;
+    for (size_t i = 0; i < 100000; ++i) {
+        for (size_t j = 0, n = 4 + rng() % 20; j < n; ++j)
+            wide += kana[rng() % 12];
+        wide += '\n';
+    }
+    const auto wideTable = ccutils::Column(names).width(12) + ccutils::Spacer(2)
+        + ccutils::Column(wide).width(60).indent(2);
+
+    cout << "Columns::toString, wide text: " << ccutils::microbench<chrono::milliseconds, 1, 5>([&] {
+        sink += wideTable.toString().size();
+    }) << " ms" << endl;
+
+    return sink == 42;
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <FlatHashMap.hpp>
+#include <microbench.hpp>
+#include <random.hpp>
+
+using namespace std;
+
+template <typename Map, typename Keys> void report(const char* name, const Keys& keys) {
+    auto insert = ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        Map m;
+        for (const auto& k : keys)
+            m[k] = 1;
+    });
+
+    Map m;
+    for (const auto& k : keys)
+        m[k] = 1;
+    size_t hits = 0;
+    auto lookup = ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (const auto& k : keys)
+            hits += m.count(k);
+    });
+
+    auto erase = ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        Map copy = m;
+        for (const auto& k : keys)
+            copy.erase(k);
+    });
+
+    cout << name << ": insert " << insert << "us, lookup " << lookup << "us, copy+erase " << erase
+         << "us (" << hits << ")" << endl;
+}
+
+int main() {
+    constexpr size_t n = 1 << 20;
+    auto rng = ccutils::random();
+
+    vector<uint64_t> ints(n);
+    for (auto& k : ints)
+        k = rng();
+    report<unordered_map<uint64_t, int>>("std::unordered_map<uint64_t>", ints);
+    report<ccutils::FlatHashMap<uint64_t, int>>("ccutils::FlatHashMap<uint64_t>", ints);
+
+    vector<string> strings(n);
+    for (auto& k : strings)
+        k = "key_" + to_string(rng());
+    report<unordered_map<string, int>>("std::unordered_map<string>", strings);
+    report<ccutils::FlatHashMap<string, int>>("ccutils::FlatHashMap<string>", strings);
+}
@@ -0,0 +1,41 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+
+#include <Logger.hpp>
+
+using namespace std;
+
+int main() {
+    // small enough batches that the ring never fills up, and flushed in between, so that this is
+    // the cost on the calling thread alone
+    constexpr size_t count = 4096;
+    ccutils::Logger::global().setOutput(open("/dev/null", O_WRONLY));
+    const string user = "someone@example.com";
+
+    auto bench = [&](const char* name, auto&& f) {
+        double best = 1e300;
+        for (int round = 0; round < 100; ++round) {
+            ccutils::Logger::global().flush();
+            const auto start = chrono::steady_clock::now();
+            for (size_t i = 0; i < count; ++i)
+                f(i);
+            best = min(best, chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+        }
+        cout << name << ": " << best / count << " ns/call" << endl;
+    };
+
+    bench("LOG_INFO no arguments", [](size_t) { LOG_INFO("request served"); });
+    bench("LOG_INFO numbers", [](size_t i) { LOG_INFO("request %zu served in %.3f ms", i, i * 0.25); });
+    bench("LOG_INFO strings", [&](size_t i) { LOG_INFO("%s fetched %s (%zu)", user, "/index.html", i); });
+    bench("LOG_DEBUG disabled", [](size_t i) { LOG_DEBUG("request %zu", i); });
+
+    // the calling thread does the same work in binary; the background thread skips formatting
+    ccutils::Logger::global().setOutput(open("/dev/null", O_WRONLY), ccutils::LogFormat::Binary);
+    bench("LOG_INFO strings, binary", [&](size_t i) { LOG_INFO("%s fetched %s (%zu)", user, "/index.html", i); });
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <sys/resource.h>
+
+#include <TableWriter.hpp>
+#include <microbench.hpp>
+#include <random.hpp>
+
+using namespace std;
+
+int main() {
+    // query output: an id, a status and a message that wraps, a million rows into /dev/null
+    auto& rng = ccutils::threadRandom();
+    static const char* words[] = { "request", "timeout", "(retry)", "backend", "db.query",
+        "user=42", "failed,", "served", "in", "12ms;", "cache", "miss" };
+    constexpr size_t count = 1000000;
+    ofstream null("/dev/null");
+
+    string id, message;
+    cout << "TableWriter, 1M rows: " << ccutils::microbench<chrono::milliseconds, 1, 3>([&] {
+        ccutils::TableWriter table(null);
+        table.header({ "id", "status", "message" }).maxWidth(100);
+        for (size_t i = 0; i < count; ++i) {
+            id = to_string(i);
+            message.clear();
+            for (size_t j = 0, n = 4 + rng() % 20; j < n; ++j) {
+                message += words[rng() % 12];
+                message += ' ';
+            }
+            table.row({ id, i % 7 ? "ok" : "error", message });
+        }
+    }) << " ms" << endl;
+
+    // the rows are not kept, so this is about what the process needs to start with
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << "peak memory: " << usage.ru_maxrss / 1024 << " MiB" << endl;
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <dump.hpp>
+#include <microbench.hpp>
+#include <random.hpp>
+
+using namespace std;
+
+struct Node {
+    uint32_t val;
+    Node* left = nullptr;
+    Node* right = nullptr;
+};
+
+struct Branch {
+    uint32_t val;
+    vector<Branch> children;
+};
+
+int main() {
+    // a million nodes into /dev/null: an unbalanced binary search tree of random keys, and a tree
+    // eight wide
+    constexpr size_t count = 1000000;
+    auto& rng = ccutils::threadRandom();
+    ofstream null("/dev/null");
+
+    vector<Node> nodes(count);
+    nodes[0].val = uint32_t(rng());
+    for (size_t i = 1; i < count; ++i) {
+        nodes[i].val = uint32_t(rng());
+        for (Node* parent = &nodes[0];;) {
+            Node*& slot = nodes[i].val < parent->val ? parent->left : parent->right;
+            if (!slot) {
+                slot = &nodes[i];
+                break;
+            }
+            parent = slot;
+        }
+    }
+    Node& root = nodes[0];
+
+    ccutils::TreeDumper<Node> binary;
+    cout << "TreeDumper, 1M binary nodes: " << ccutils::microbench<chrono::milliseconds, 1, 3>([&] {
+        binary.dump(null, &root);
+    }) << " ms" << endl;
+
+    Branch wide { 0, {} };
+    vector<Branch*> level { &wide };
+    for (size_t made = 1; made < count;) {
+        vector<Branch*> next;
+        for (Branch* branch : level) {
+            branch->children.resize(min<size_t>(8, count - made));
+            for (auto& child : branch->children) {
+                child.val = uint32_t(made++);
+                next.push_back(&child);
+            }
+        }
+        level = move(next);
+    }
+
+    ccutils::TreeDumper<Branch> nary;
+    cout << "TreeDumper, 1M nodes 8 wide: " << ccutils::microbench<chrono::milliseconds, 1, 3>([&] {
+        nary.dump(null, &wide);
+    }) << " ms" << endl;
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <fastRandom.hpp>
+#include <microbench.hpp>
+#include <random.hpp>
+
+using namespace std;
+
+// uniformInts stays within [lo, hi], including 8- and 16-bit types whose difference promotes to int
+template <typename T> bool inBounds(T lo, T hi) {
+    vector<T> values(1 << 16);
+    ccutils::uniformInts<T>(values.data(), values.data() + values.size(), lo, hi);
+    auto [min, max] = minmax_element(values.begin(), values.end());
+    if (*min == lo && *max == hi)
+        return true;
+    cerr << "uniformInts(" << +lo << ", " << +hi << ") gave " << +*min << " to " << +*max << endl;
+    return false;
+}
+
+int main() {
+    if (!inBounds<int8_t>(-3, 3) || !inBounds<int16_t>(-10, 10) || !inBounds<int8_t>(-128, 127)
+        || !inBounds<int16_t>(-1000, -990) || !inBounds<uint8_t>(250, 255))
+        return 1;
+
+
+    constexpr size_t n = 1 << 20;
+    vector<char> bytes(n * sizeof(uint32_t));
+    vector<uint32_t> ints(n);
+    vector<double> doubles(n);
+
+    auto perByte = [&](double us) { return bytes.size() / us / 1e3; };
+
+    cout << "randomFill: " << perByte(ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        ccutils::randomFill(bytes.data(), bytes.data() + bytes.size());
+    })) << " GB/s" << endl;
+
+    auto mt = ccutils::random();
+    uniform_int_distribution<uint32_t> dist;
+    cout << "mt19937 per uint32: " << perByte(ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (auto& x : ints)
+            x = dist(mt);
+    })) << " GB/s" << endl;
+
+    cout << "fastRandomFill: " << perByte(ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        ccutils::fastRandomFill(bytes.data(), bytes.data() + bytes.size());
+    })) << " GB/s" << endl;
+
+    uniform_int_distribution<uint32_t> dice(1, 6);
+    cout << "uniform_int_distribution(1, 6): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (auto& x : ints)
+            x = dice(ccutils::threadRandom());
+    }) << " us" << endl;
+    cout << "uniformInts(1, 6): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        ccutils::uniformInts<uint32_t>(ints.data(), ints.data() + n, 1, 6);
+    }) << " us" << endl;
+
+    uniform_real_distribution<double> unit;
+    cout << "uniform_real_distribution: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (auto& x : doubles)
+            x = unit(ccutils::threadRandom());
+    }) << " us" << endl;
+    cout << "uniformDoubles: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        ccutils::uniformDoubles(doubles.data(), doubles.data() + n);
+    }) << " us" << endl;
+}
@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <formatFloat.hpp>
+#include <microbench.hpp>
+#include <print.hpp>
+#include <random.hpp>
+
+using namespace std;
+
+int main() {
+    constexpr size_t count = 1 << 18;
+    auto& rng = ccutils::threadRandom();
+
+    // latencies and rates, as a metrics exporter would print them
+    vector<double> values(count);
+    for (double& v : values)
+        v = double(rng() % 10000000) / 1000.0;
+
+    char buffer[64];
+    size_t sink = 0;
+
+    cout << "snprintf(\"%.3f\"): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (double v : values)
+            sink += snprintf(buffer, sizeof(buffer), "%.3f", v);
+    }) << " us" << endl;
+
+    string out;
+    cout << "Printf(\"%.3f\"): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (double v : values) {
+            out.clear();
+            ccutils::print_detail::container_writer<string> ctx(out);
+            sink += ccutils::print_detail::Printf(ctx, "%.3f", v);
+        }
+    }) << " us" << endl;
+
+    cout << "snprintf(\"%.17g\"): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (double v : values)
+            sink += snprintf(buffer, sizeof(buffer), "%.17g", v);
+    }) << " us" << endl;
+
+    cout << "formatShortest: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (double v : values)
+            sink += ccutils::formatShortest(buffer, v);
+    }) << " us" << endl;
+
+    return sink == 42;
+}
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <microbench.hpp>
+#include <parse.hpp>
+#include <random.hpp>
+
+using namespace std;
+
+int main() {
+    constexpr size_t count = 1 << 18;
+    auto& rng = ccutils::threadRandom();
+
+    vector<string> ints(count), doubles(count);
+    char buffer[64];
+    for (size_t i = 0; i < count; ++i) {
+        ints[i] = to_string(int64_t(rng()) >> (rng() % 64));
+        snprintf(buffer, sizeof(buffer), "%.17g", double(rng() >> 11) * 0x1.0p-53 * 1e6);
+        doubles[i] = buffer;
+    }
+    long long intSink = 0;
+    double doubleSink = 0;
+
+    cout << "istringstream (int64): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (const string& s : ints) {
+            istringstream stream(s);
+            long long value;
+            stream >> value;
+            intSink += value;
+        }
+    }) << " us" << endl;
+
+    cout << "strtoll: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (const string& s : ints)
+            intSink += strtoll(s.c_str(), nullptr, 10);
+    }) << " us" << endl;
+
+    cout << "parseInt<int64_t>: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (const string& s : ints) {
+            int64_t value = 0;
+            ccutils::parseInt(s.data(), s.data() + s.size(), value);
+            intSink += value;
+        }
+    }) << " us" << endl;
+
+    cout << "istringstream (double): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (const string& s : doubles) {
+            istringstream stream(s);
+            double value;
+            stream >> value;
+            doubleSink += value;
+        }
+    }) << " us" << endl;
+
+    cout << "strtod: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (const string& s : doubles)
+            doubleSink += strtod(s.c_str(), nullptr);
+    }) << " us" << endl;
+
+    cout << "parseDouble: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (const string& s : doubles) {
+            double value = 0;
+            ccutils::parseDouble(s.data(), s.data() + s.size(), value);
+            doubleSink += value;
+        }
+    }) << " us" << endl;
+
+    return int(intSink + doubleSink) == 42;
+}
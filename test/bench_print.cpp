@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <microbench.hpp>
+#include <print.hpp>
+#include <random.hpp>
+
+using namespace std;
+
+int main() {
+    constexpr size_t count = 1 << 16;
+    auto& rng = ccutils::threadRandom();
+
+    // log lines with padded columns, as a table or a metrics exporter would print them
+    vector<int> ids(count);
+    vector<double> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        ids[i] = int(rng() % 1000000);
+        values[i] = double(rng() % 10000000) / 1000.0;
+    }
+
+    char buffer[256];
+    size_t sink = 0;
+
+    cout << "snprintf: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i)
+            sink += snprintf(buffer, sizeof(buffer), "%-12s %8d %12.3f|%24s|\n", "request", ids[i],
+                values[i], "ok");
+    }) << " us" << endl;
+
+    cout << "sprint(char*): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i)
+            sink += ccutils::sprint(buffer, sizeof(buffer), "%-12s %8d %12.3f|%24s|\n", "request",
+                ids[i], values[i], "ok");
+    }) << " us" << endl;
+
+    ostringstream os;
+    cout << "ostream <<: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i) {
+            os.str("");
+            os << left << setw(12) << "request" << ' ' << right << setw(8) << ids[i] << ' ' << setw(12)
+               << fixed << setprecision(3) << values[i] << '|' << setw(24) << "ok" << "|\n";
+            sink += os.tellp();
+        }
+    }) << " us" << endl;
+
+    cout << "sprint(ostream): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i) {
+            os.str("");
+            sink += ccutils::sprint(os, "%-12s %8d %12.3f|%24s|\n", "request", ids[i], values[i], "ok");
+        }
+    }) << " us" << endl;
+
+    string out;
+    cout << "Printf(string): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i) {
+            out.clear();
+            ccutils::print_detail::container_writer<string> ctx(out);
+            sink += ccutils::print_detail::Printf(
+                ctx, "%-12s %8d %12.3f|%24s|\n", "request", ids[i], values[i], "ok");
+        }
+    }) << " us" << endl;
+
+    cout << "sprint(ostream, CCUTILS_FMT): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i) {
+            os.str("");
+            sink += ccutils::sprint(
+                os, CCUTILS_FMT("%-12s %8d %12.3f|%24s|\n"), "request", ids[i], values[i], "ok");
+        }
+    }) << " us" << endl;
+
+    // integer heavy, as a metrics dump: counters of every size, ids in hex
+    vector<uint64_t> counters(count);
+    for (size_t i = 0; i < count; ++i)
+        counters[i] = rng() >> (rng() % 64);
+
+    cout << "snprintf integers: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i)
+            sink += snprintf(buffer, sizeof(buffer), "%d %lu %12lu %#lx %lx\n", ids[i], counters[i],
+                counters[i] >> 20, counters[i], counters[i] & 0xffff);
+    }) << " us" << endl;
+
+    cout << "sprint(char*) integers: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i)
+            sink += ccutils::sprint(buffer, sizeof(buffer), "%d %lu %12lu %#lx %lx\n", ids[i],
+                counters[i], counters[i] >> 20, counters[i], counters[i] & 0xffff);
+    }) << " us" << endl;
+
+    cout << "Printf(string) integers: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < count; ++i) {
+            out.clear();
+            ccutils::print_detail::container_writer<string> ctx(out);
+            sink += ccutils::print_detail::Printf(ctx, "%d %lu %12lu %#lx %lx\n", ids[i], counters[i],
+                counters[i] >> 20, counters[i], counters[i] & 0xffff);
+        }
+    }) << " us" << endl;
+
+    return sink == 42;
+}
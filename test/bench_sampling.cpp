@@ -0,0 +1,58 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <microbench.hpp>
+#include <random.hpp>
+#include <sampling.hpp>
+
+using namespace std;
+
+int main() {
+    constexpr size_t draws = 1 << 20;
+    auto& rng = ccutils::threadRandom();
+    size_t sink = 0;
+
+    vector<double> weights(1000);
+    for (size_t i = 0; i < weights.size(); ++i)
+        weights[i] = 1.0 / (i + 1);
+
+    discrete_distribution<size_t> discrete(weights.begin(), weights.end());
+    cout << "std::discrete_distribution: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < draws; ++i)
+            sink += discrete(rng);
+    }) << " us" << endl;
+
+    ccutils::AliasTable alias(weights);
+    cout << "AliasTable: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < draws; ++i)
+            sink += alias(rng);
+    }) << " us" << endl;
+
+    // Zipf with s = 1.2 over a million keys; the std baseline has to go through a table.
+    constexpr size_t keys = 1000000;
+    vector<double> zipfWeights(keys);
+    for (size_t i = 0; i < keys; ++i)
+        zipfWeights[i] = pow(double(i + 1), -1.2);
+    discrete_distribution<size_t> zipfTable(zipfWeights.begin(), zipfWeights.end());
+    cout << "Zipf via std::discrete_distribution: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < draws; ++i)
+            sink += zipfTable(rng);
+    }) << " us" << endl;
+
+    ccutils::ZipfDistribution zipf(keys, 1.2);
+    cout << "ZipfDistribution: " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        for (size_t i = 0; i < draws; ++i)
+            sink += zipf(rng);
+    }) << " us" << endl;
+
+    cout << "WeightedReservoir(100): " << ccutils::microbench<chrono::microseconds, 1, 10>([&] {
+        ccutils::WeightedReservoir<size_t> reservoir(100);
+        for (size_t i = 0; i < draws; ++i)
+            reservoir.add(i, weights[i % weights.size()], rng);
+        sink += reservoir.size();
+    }) << " us" << endl;
+
+    cout << sink << endl;
+}
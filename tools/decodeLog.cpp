@@ -0,0 +1,73 @@
+// Prints binary logs written by ccutils::Logger as text.
+//
+//     decodeLog [FILE]...
+//
+// Reads the standard input if no file is given. Works on logs that are still being written, a
+// trailing incomplete record is reported and skipped.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <BinaryLog.hpp>
+
+static bool decodeFile(const char* name, int fd) {
+    ccutils::BinaryLogDecoder decoder;
+    std::vector<char> buffer(1 << 20);
+    std::string text;
+    size_t pending = 0;
+    while (true) {
+        if (pending == buffer.size())
+            buffer.resize(buffer.size() * 2);
+        const ssize_t n = read(fd, buffer.data() + pending, buffer.size() - pending);
+        if (n < 0) {
+            std::fprintf(stderr, "decodeLog: %s: %s\n", name, std::strerror(errno));
+            return false;
+        }
+        if (n == 0)
+            break;
+        pending += n;
+
+        text.clear();
+        size_t used;
+        try {
+            used = decoder.decode(std::string_view(buffer.data(), pending), text);
+        } catch (const std::runtime_error& e) {
+            // the lines of the entries before the bad one are complete
+            std::fwrite(text.data(), 1, text.size(), stdout);
+            std::fflush(stdout);
+            std::fprintf(stderr, "decodeLog: %s: %s\n", name, e.what());
+            return false;
+        }
+        std::fwrite(text.data(), 1, text.size(), stdout);
+        std::memmove(buffer.data(), buffer.data() + used, pending - used);
+        pending -= used;
+    }
+    if (pending != 0)
+        std::fprintf(stderr, "decodeLog: %s: ends with an incomplete record\n", name);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2)
+        return decodeFile("<stdin>", STDIN_FILENO) ? 0 : 1;
+
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        const int fd = open(argv[i], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::fprintf(stderr, "decodeLog: %s: %s\n", argv[i], std::strerror(errno));
+            ok = false;
+            continue;
+        }
+        ok = decodeFile(argv[i], fd) && ok;
+        close(fd);
+    }
+    return ok ? 0 : 1;
+}